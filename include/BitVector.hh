@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BITVECTOR_HH_
+#define BITVECTOR_HH_
+
+#include "ColumbusCore.hh"
+
+/*
+ * An immutable bit vector with constant time rank and fast select, used by
+ * the succinct trie.
+ *
+ * build() serializes the bits together with their lookup tables into a
+ * flat image that can be written to disk as is. The bits are given
+ * packed 64 to a word, starting from the lowest bit. A BitVector only points
+ * into such an image, so it can be used on a read-only mapping without
+ * copying anything.
+ *
+ * Rank uses the number of ones before each 64 bit word. Select jumps to
+ * the word holding every SELECT_SAMPLE:th one or zero and scans from there.
+ */
+
+COL_NAMESPACE_START
+
+class BitVector final {
+private:
+    const uint64_t *bits;
+    const uint32_t *ranks; // Ones before each word, plus the total.
+    const uint32_t *oneSamples;
+    const uint32_t *zeroSamples;
+    size_t numBits;
+    size_t numOnes;
+
+    static size_t selectInWord(uint64_t word, size_t k);
+
+public:
+    static const size_t SELECT_SAMPLE = 256;
+
+    BitVector();
+
+    // The size of the image in bytes, always a multiple of eight.
+    static size_t imageSize(const size_t numBits, const size_t numOnes);
+    // The image must have room for imageSize() bytes.
+    static void build(const uint64_t *source, const size_t numBits, void *image);
+    // Returns the size of the image in bytes.
+    size_t attach(const void *image, const size_t maxBytes);
+
+    size_t size() const { return numBits; }
+    size_t ones() const { return numOnes; }
+    bool get(const size_t i) const { return (bits[i/64] >> (i%64)) & 1; }
+    // The number of ones or zeros in [0, i).
+    size_t rank1(const size_t i) const {
+        const uint64_t mask = (((uint64_t)1) << (i%64)) - 1;
+        return ranks[i/64] + __builtin_popcountll(bits[i/64] & mask);
+    }
+    size_t rank0(const size_t i) const { return i - rank1(i); }
+    // The position of the k:th one or zero, counting from zero.
+    size_t select1(const size_t k) const;
+    size_t select0(const size_t k) const;
+};
+
+COL_NAMESPACE_END
+
+#endif /* BITVECTOR_HH_ */
@@ -27,7 +27,7 @@ COL_NAMESPACE_START
 class Word;
 class WordList;
 
-Letter* utf8ToInternal(const char *utf8Text, unsigned int &resultStringSize);
+unsigned int utf8ToInternal(const char *utf8Text, const size_t bytes, Letter *result);
 void internalToUtf8(const Letter *source, unsigned int characters, char *buf, unsigned int bufsize);
 COL_PUBLIC COL_PUBLIC double hiresTimestamp();
 COL_PUBLIC WordList splitToWords(const char *utf8Text);
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTAINERMEMORY_HH_
+#define CONTAINERMEMORY_HH_
+
+#include "ColumbusCore.hh"
+
+/*
+ * Estimates of the heap memory standard containers use for their
+ * elements. They count the node and bucket overhead of typical
+ * implementations, but not memory the elements themselves point to.
+ */
+
+COL_NAMESPACE_START
+
+// Any container with contiguous storage, such as a vector.
+template<typename T>
+size_t vectorMemory(const T &v) {
+    return v.capacity()*sizeof(typename T::value_type);
+}
+
+// One node per element holding the element, a next pointer and the hash.
+template<typename T>
+size_t hashMemory(const T &m) {
+    return m.bucket_count()*sizeof(void*) + m.size()*(sizeof(typename T::value_type) + 2*sizeof(void*));
+}
+
+// Tree nodes hold the element, three pointers and the node colour.
+template<typename T>
+size_t treeMemory(const T &m) {
+    return m.size()*(sizeof(typename T::value_type) + 4*sizeof(void*));
+}
+
+// List nodes hold the element and two pointers.
+template<typename T>
+size_t listMemory(const T &l) {
+    return l.size()*(sizeof(typename T::value_type) + 2*sizeof(void*));
+}
+
+COL_NAMESPACE_END
+
+#endif /* CONTAINERMEMORY_HH_ */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DAWG_HH_
+#define DAWG_HH_
+
+#include "ColumbusCore.hh"
+
+/*
+ * A minimized directed acyclic word graph. It is a trie where identical
+ * subtrees are stored only once, so words share their suffixes as well as
+ * their prefixes.
+ *
+ * A shared node can not hold a WordID. Instead every node knows how many
+ * words can be reached from it. Counting the words passed on the way from
+ * the root numbers the words in sorted order without gaps, and that
+ * number indexes a table of WordIDs. The handles therefore carry that
+ * count in their upper 32 bits and a node or edge number in the lower.
+ *
+ * The traversal functions mirror those of Trie. Zero means none.
+ */
+
+COL_NAMESPACE_START
+
+class Trie;
+class Word;
+class SnapshotWriter;
+class SnapshotReader;
+
+struct DawgPrivate;
+
+class Dawg final {
+private:
+    DawgPrivate *p;
+
+public:
+    Dawg();
+    ~Dawg();
+    Dawg(const Dawg &other) = delete;
+    const Dawg & operator=(const Dawg &other) = delete;
+
+    void build(const Trie &trie);
+    // Inserts all words into an empty trie.
+    void copyTo(Trie &trie) const;
+    void clear();
+
+    size_t numNodes() const;
+    size_t numWords() const;
+    size_t memoryUsage() const;
+    GraphOffset findWord(const Word &word) const;
+
+    GraphOffset getRoot() const;
+    GraphOffset getSiblingList(const GraphOffset node) const;
+    GraphOffset getNextSibling(const GraphOffset sibling) const;
+    bool hasSibling(const GraphOffset sibling) const;
+    Letter getLetter(const GraphOffset sibling) const;
+    GraphOffset getChild(const GraphOffset sibling) const;
+    WordID getWordID(const GraphOffset node) const;
+
+    void save(SnapshotWriter &out) const;
+    // Replaces the contents only if the whole graph is valid.
+    void load(SnapshotReader &in);
+};
+
+COL_NAMESPACE_END
+
+#endif /* DAWG_HH_ */
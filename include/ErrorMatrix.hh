@@ -48,6 +48,8 @@ public:
     void set(const size_t rowNum, const size_t colNum, const int error);
     // No bounds checking because this is in the hot path.
     inline int get(const size_t rowNum, const size_t colNum) const { return m[rowNum][colNum]; }
+    inline int* getRow(const size_t rowNum) { return m[rowNum]; }
+    inline const int* getRow(const size_t rowNum) const { return m[rowNum]; }
     int totalError(const size_t rowNum) const;
     int minError(const size_t rowNum) const;
 
@@ -78,6 +78,8 @@ public:
     void setSubstringStartLimit(const size_t e) { substringStartLimit = e; }
 
     int getSubstituteError(Letter l1, Letter l2) const;
+    void getSubstituteErrors(Letter l, const Letter *letters, const size_t length, int *errors) const;
+    bool hasUniformErrors(const size_t queryTermLength) const;
 
     static int getDefaultError() { return ErrorValues::DEFAULT_ERROR; }
     static int getDefaultGroupError() { return ErrorValues::DEFAULT_GROUP_ERROR; }
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCREMENTALSEARCH_HH_
+#define INCREMENTALSEARCH_HH_
+
+#include "ColumbusCore.hh"
+
+COL_NAMESPACE_START
+
+struct IncrementalSearchPrivate;
+class Word;
+class ErrorValues;
+class IndexMatches;
+class WordGraph;
+class LevenshteinIndex;
+
+/**
+ * The state of a LevenshteinIndex search kept around for the next one.
+ *
+ * The error matrix is stored by query position for every trie node the
+ * search has reached. When the next query extends the previous one only
+ * the new query positions are evaluated for those nodes, and only nodes
+ * that came within the maximum error are expanded further. Typing one
+ * more letter then costs one matrix column per node the search reaches
+ * instead of a whole new search. Nodes that drop out are kept and
+ * caught up if a longer query reaches them again.
+ *
+ * Any other query starts over. So does a change in the start insertion
+ * error, which depends on the query length in substring mode.
+ *
+ * Results are identical to LevenshteinIndex::findWords with the same
+ * query, error values and maximum error. Error values must not change
+ * or be destroyed while the search exists, and neither may the index.
+ */
+class COL_PUBLIC IncrementalSearch final {
+    friend class LevenshteinIndex;
+
+private:
+    IncrementalSearchPrivate *p;
+
+    void search(const WordGraph &graph, const LevenshteinIndex *index, const Word &query, const int maxError,
+            IndexMatches &matches);
+
+public:
+    explicit IncrementalSearch(const ErrorValues &e);
+    ~IncrementalSearch();
+    IncrementalSearch(const IncrementalSearch &other) = delete;
+    const IncrementalSearch & operator=(const IncrementalSearch &other) = delete;
+
+    void reset();
+    size_t numNodes() const;
+};
+
+COL_NAMESPACE_END
+
+#endif /* INCREMENTALSEARCH_HH_ */
@@ -36,12 +36,14 @@ class Word;
  */
 class COL_PUBLIC IndexMatches final {
     friend class LevenshteinIndex;
+    friend class IncrementalSearch;
 
 private:
 
     IndexMatchesPrivate *p;
 
     void addMatch(const Word &queryWord, const WordID matchedWord, int error);
+    void addWork(const size_t nodesVisited, const size_t cellsComputed);
     void sort();
 
 public:
@@ -54,6 +56,8 @@ public:
     const WordID& getMatch(size_t num) const;
     const Word& getQuery(size_t num) const;
     int getMatchError(size_t num) const;
+    size_t getNodesVisited() const;
+    size_t getCellsComputed() const;
     void clear();
 
 };
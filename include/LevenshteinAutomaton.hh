@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LEVENSHTEINAUTOMATON_HH_
+#define LEVENSHTEINAUTOMATON_HH_
+
+#include "ColumbusCore.hh"
+
+COL_NAMESPACE_START
+
+struct LevenshteinAutomatonPrivate;
+class Word;
+class ErrorValues;
+
+/**
+ * A query word compiled into a weighted Levenshtein automaton.
+ *
+ * Every trie node reached by LevenshteinIndex corresponds to one
+ * state, which is the node's row of the error matrix with all values
+ * above the maximum error clamped together. States and the transitions
+ * between them are built lazily and memoized, so walking an edge whose
+ * transition has already been seen is a single table lookup instead of
+ * a full row evaluation. The same automaton can be used to search any
+ * number of indexes.
+ *
+ * Results are identical to LevenshteinIndex::findWords with the same
+ * query, error values and maximum error. Error values must not be
+ * negative and must not change or be destroyed while the automaton
+ * exists.
+ */
+class COL_PUBLIC LevenshteinAutomaton final {
+    friend class LevenshteinIndex;
+
+public:
+    typedef uint32_t State;
+
+private:
+    LevenshteinAutomatonPrivate *p;
+
+    State startState() const;
+    State step(const State from, const Letter letter, const size_t depth);
+    int totalError(const State s) const;
+    bool isDead(const State s) const;
+    int getUniformError() const;
+    size_t cellsComputed() const;
+
+public:
+    static const size_t DEFAULT_MAX_STATES = 100000;
+
+    LevenshteinAutomaton(const Word &query, const ErrorValues &e, const int maxError,
+            const size_t maxStates=DEFAULT_MAX_STATES);
+    ~LevenshteinAutomaton();
+    LevenshteinAutomaton(const LevenshteinAutomaton &other) = delete;
+    const LevenshteinAutomaton & operator=(const LevenshteinAutomaton &other) = delete;
+
+    const Word& getQuery() const;
+    int getMaxError() const;
+    size_t numStates() const;
+};
+
+COL_NAMESPACE_END
+
+#endif /* LEVENSHTEINAUTOMATON_HH_ */
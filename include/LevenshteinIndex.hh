@@ -22,27 +22,43 @@
 
 #include "ColumbusCore.hh"
 #include "IndexMatches.hh"
+#include <string>
 
 COL_NAMESPACE_START
 
 struct LevenshteinIndexPrivate;
 struct TrieNode;
+struct BitParallelQuery;
+struct BitParallelRow;
+struct CompletionCandidates;
 class ErrorMatrix;
 class Word;
 class ErrorValues;
+class LevenshteinAutomaton;
+class IncrementalSearch;
 
 class COL_PUBLIC LevenshteinIndex final {
 private:
     LevenshteinIndexPrivate *p;
 
-    void searchRecursive(const Word &query, TrieOffset node, const ErrorValues &e,
+    void searchRecursive(const Word &query, GraphOffset node, const ErrorValues &e,
             const Letter letter, const Letter previousLetter, const size_t depth, ErrorMatrix &em,
-            IndexMatches &matches, const int max_error) const;
+            int *substituteErrors, IndexMatches &matches, const int max_error) const;
 
-    int findOptimalError(const Letter letter, const Letter previousLetter, const Word &query,
-            const size_t i, const size_t depth, const ErrorMatrix &em, const ErrorValues &e) const;
+    void findWordsBitParallel(const Word &query, const int unitError, const int maxError,
+            IndexMatches &matches) const;
+    void searchBitParallel(const BitParallelQuery &q, GraphOffset node, const BitParallelRow &previous,
+            const Letter letter, const size_t depth, IndexMatches &matches, const int maxUnits) const;
+    void searchAutomaton(LevenshteinAutomaton &a, GraphOffset node, const uint32_t previousState,
+            const Letter letter, const size_t depth, IndexMatches &matches) const;
+    void searchCompletions(const Word &query, GraphOffset node, const ErrorValues &e,
+            const Letter letter, const Letter previousLetter, const size_t depth, ErrorMatrix &em,
+            int *substituteErrors, CompletionCandidates &candidates, const int maxError) const;
+    void expandGraph();
 
 public:
+    static const size_t COMPLETIONS_PER_PREFIX = 8;
+
     LevenshteinIndex();
     ~LevenshteinIndex();
     LevenshteinIndex(const LevenshteinIndex &other) = delete;
@@ -54,10 +70,41 @@ public:
     bool hasWord(const Word &word) const;
 
     void findWords(const Word &query, const ErrorValues &e, const int maxError, IndexMatches &matches) const;
+    void findWords(LevenshteinAutomaton &a, IndexMatches &matches) const;
+    void findWords(IncrementalSearch &s, const Word &query, const int maxError, IndexMatches &matches) const;
+    /*
+     * Treats the query as the start of a word. Finds the trie nodes whose
+     * prefix is within maxError of the query and returns the words stored
+     * at them along with the COMPLETIONS_PER_PREFIX most common words
+     * below each. A word's error is that of its best matching prefix.
+     * Nodes below a match are not searched when they can not match
+     * better, so the cost depends on the query rather than on how many
+     * words complete it. Matches with equal error are most common first.
+     * The completion lists are built by the first call after the index
+     * has changed, which costs a walk of the whole index.
+     */
+    void findCompletions(const Word &query, const ErrorValues &e, const int maxError, IndexMatches &matches) const;
     size_t wordCount(const WordID queryID) const;
     size_t maxCount() const;
     size_t numNodes() const;
     size_t numWords() const;
+    // Bytes used by the trie or word graph and the word counts.
+    size_t memoryUsage() const;
+
+    // Compacts the trie for faster searching once all words are in.
+    void freeze();
+    // Uses a succinct trie instead, which takes much less memory.
+    void compact();
+    /*
+     * Replaces the trie with a minimized word graph that also shares
+     * suffixes, see Dawg.hh. Searches give the same results. Inserting
+     * words afterwards turns it back into a trie first.
+     */
+    void minimize();
+    bool isMinimized() const;
+
+    void save(const std::string &basename) const;
+    void load(const std::string &basename);
 };
 
 COL_NAMESPACE_END
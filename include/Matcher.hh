@@ -35,31 +35,90 @@ class ErrorValues;
 class IndexWeights;
 class ResultFilter;
 class SearchParameters;
+class QuerySession;
+class MemoryUsage;
 
 class COL_PUBLIC Matcher final {
 private:
     MatcherPrivate *p;
 
     void buildIndexes(const Corpus &c);
-    void addToIndex(const Word &word, const WordID wordID, const WordID indexID);
-    void relevancyMatch(const WordList &query, const SearchParameters &params, const int extraError, MatchResults &matchedDocuments);
+    void relevancyMatch(const WordList &query, const SearchParameters &params, const int extraError,
+            MatchResults &matchedDocuments, QuerySession *session) const;
+    MatchResults onlineMatch(const WordList &query, const Word &primaryIndex, QuerySession *session) const;
 
 public:
     Matcher();
     ~Matcher();
     Matcher& operator=(const Matcher &m) = delete;
 
+    /*
+     * Thread safety: the const member functions only read the matcher
+     * and keep all their working data in the call. Any number of threads
+     * may call them at the same time on one matcher, as long as nothing
+     * calls a non-const member function concurrently. This includes
+     * changing the error values, index weights or thread count. The
+     * returned MatchResults are not shared with anything, but a single
+     * MatchResults object is not safe to read from several threads.
+     */
+
     // The simple API
     MatchResults match(const char *queryAsUtf8);
     MatchResults match(const WordList &query);
     MatchResults match(const std::string &queryAsUtf8);
+    MatchResults match(const char *queryAsUtf8) const;
+    MatchResults match(const WordList &query) const;
+    MatchResults match(const std::string &queryAsUtf8) const;
 
     // When you want to specify search parameters exactly.
     MatchResults match(const char *queryAsUtf8, const SearchParameters &params);
     MatchResults match(const WordList &query, const SearchParameters &params);
+    MatchResults match(const char *queryAsUtf8, const SearchParameters &params) const;
+    MatchResults match(const WordList &query, const SearchParameters &params) const;
     void index(const Corpus &c);
+    /*
+     * Streaming alternative to index(). The text is split into words
+     * right away and kept in compact form without building Documents
+     * or a Corpus. A Word is only built the first time a token is
+     * seen. Nothing is searchable until commit() builds the
+     * indexes. Each field of a document should be added only once.
+     */
+    void addText(const DocumentID id, const Word &field, const char *textAsUtf8);
+    void addText(const DocumentID id, const Word &field, const std::string &textAsUtf8);
+    void commit();
     ErrorValues& getErrorValues();
     IndexWeights& getIndexWeights();
+
+    /*
+     * Number of threads used for searching, including the calling
+     * thread. Every query word and field pair is searched as a separate
+     * task. Results do not depend on the thread count. The default is one.
+     */
+    void setThreadCount(const size_t numThreads);
+    size_t getThreadCount() const;
+    /*
+     * Store the word list and field indexes built by index() as succinct
+     * tries. They take several times less memory, but searches get
+     * somewhat slower. The default is off. Affects indexes built after
+     * the call.
+     */
+    void setSuccinctTries(const bool succinct);
+    bool getSuccinctTries() const;
+    /*
+     * Store the field indexes as minimized word graphs, which share word
+     * endings as well as beginnings. Works best for large vocabularies
+     * with many common suffixes. Takes precedence over succinct tries for
+     * the field indexes. The default is off. Affects indexes built after
+     * the call.
+     */
+    void setMinimizedIndexes(const bool minimized);
+    bool getMinimizedIndexes() const;
+    /*
+     * How much memory the matcher holds, split into its parts and per
+     * field. A field's figure covers its word index and the postings of
+     * its words. Text added but not yet committed is listed as well.
+     */
+    MemoryUsage memoryUsage() const;
     /*
      * This function is optimized for online matches, that is, queries
      * that are live updated during typing. It uses slightly different
@@ -71,6 +130,30 @@ public:
      * (and nothing else) that will be executed.
      */
     MatchResults onlineMatch(const WordList &query, const Word &primaryIndex);
+    MatchResults onlineMatch(const WordList &query, const Word &primaryIndex) const;
+    /*
+     * The same, but continues the searches of the previous query made
+     * with the session when the query has only grown at the end. Each
+     * keystroke then costs about as much as the new letters. A session
+     * must only be used by one thread at a time.
+     */
+    MatchResults onlineMatch(const WordList &query, const Word &primaryIndex, QuerySession &session) const;
+
+    /*
+     * Store everything index() has built into the given directory and
+     * bring it back without reindexing. The tries are mapped read-only
+     * straight from the files. Word counts, statistics, document sizes
+     * and postings are stored as flat arrays and put back into their
+     * tables on load, which costs an insert per entry but no splitting
+     * of text or building of tries. Saving over an existing snapshot
+     * replaces it as a whole, readers never see a mix of the two.
+     *
+     * Error values and index weights are configuration rather than index
+     * data and are not part of the snapshot. Loading replaces all indexed
+     * data. If it fails, the matcher is left unchanged.
+     */
+    void saveSnapshot(const std::string &directory) const;
+    void loadSnapshot(const std::string &directory);
 };
 
 COL_NAMESPACE_END
@@ -26,6 +26,8 @@ COL_NAMESPACE_START
 
 struct MatcherStatisticsPrivate;
 class Word;
+class SnapshotWriter;
+class SnapshotReader;
 
 class MatcherStatistics final {
 private:
@@ -35,10 +37,19 @@ private:
 public:
     MatcherStatistics();
     ~MatcherStatistics();
+    MatcherStatistics(const MatcherStatistics &other) = delete;
+    const MatcherStatistics & operator=(const MatcherStatistics &other) = delete;
 
     void wordProcessed(const WordID w);
+    void wordsProcessed(const WordID w, const size_t count);
     size_t getTotalWordCount(const WordID w) const;
+    // Called concurrently for different fields during index builds.
     void addedWordToIndex(const WordID word, const Word &fieldName);
+    size_t memoryUsage() const;
+
+    void save(SnapshotWriter &out) const;
+    void load(SnapshotReader &in);
+    void swap(MatcherStatistics &other);
 };
 
 COL_NAMESPACE_END
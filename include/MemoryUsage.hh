@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORYUSAGE_HH_
+#define MEMORYUSAGE_HH_
+
+#include "ColumbusCore.hh"
+#include <string>
+
+COL_NAMESPACE_START
+
+struct MemoryUsagePrivate;
+class Word;
+
+/*
+ * A breakdown of the memory a matcher uses, as returned by
+ * Matcher::memoryUsage(). Components are the parts of the matcher in
+ * the order they were added. The field indexes are listed separately
+ * and also make up the "field indexes" component. Figures for hash
+ * tables and other containers are estimates.
+ */
+class COL_PUBLIC MemoryUsage final {
+private:
+    MemoryUsagePrivate *p;
+
+public:
+    MemoryUsage();
+    ~MemoryUsage();
+    MemoryUsage(const MemoryUsage &other);
+    MemoryUsage(MemoryUsage &&other);
+
+    const MemoryUsage& operator=(MemoryUsage &&other);
+    const MemoryUsage& operator=(const MemoryUsage &other);
+
+    void addComponent(const std::string &name, const size_t bytes);
+    void addIndex(const Word &field, const size_t bytes);
+
+    size_t numComponents() const;
+    const std::string& getComponentName(const size_t i) const;
+    size_t getComponentBytes(const size_t i) const;
+
+    size_t numIndexes() const;
+    const Word& getIndexField(const size_t i) const;
+    size_t getIndexBytes(const size_t i) const;
+
+    // Sum of all components.
+    size_t getTotal() const;
+};
+
+COL_NAMESPACE_END
+
+#endif /* MEMORYUSAGE_HH_ */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POSTINGLIST_HH_
+#define POSTINGLIST_HH_
+
+#include "ColumbusCore.hh"
+
+/*
+ * A compressed, sorted set of document IDs for ReverseIndex.
+ *
+ * IDs are stored as the differences between consecutive IDs, each
+ * written as a little endian base 128 varint. Every SKIP_INTERVAL IDs
+ * a skip table entry records the ID and where the next one starts, so
+ * lookups and intersections can binary search instead of decoding
+ * the whole list.
+ *
+ * Adding IDs in increasing order appends to the encoded data directly.
+ * Anything else goes to a pending buffer that finalize() merges in.
+ * contains() works at any time, but iterating and size() need a
+ * finalized list.
+ */
+
+COL_NAMESPACE_START
+
+class PostingList final {
+public:
+    static const size_t SKIP_INTERVAL = 128;
+
+    class Iterator final {
+        friend class PostingList;
+    private:
+        const PostingList *list;
+        const unsigned char *pos;
+        size_t index; // Of the current ID.
+        DocumentID value;
+
+    public:
+        bool atEnd() const { return index >= list->count; }
+        DocumentID get() const { return value; }
+        void next() {
+            if(++index >= list->count)
+                return;
+            value += readVarint(pos);
+        }
+        // Moves to the first ID that is not smaller than target.
+        void skipTo(const DocumentID target);
+    };
+
+private:
+    unsigned char *data; // Encoded IDs followed by the skip table once finalized.
+    uint32_t used;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t numSkips;
+    DocumentID last;
+    DocumentID *pending;
+    uint32_t numPending;
+    uint32_t pendingCapacity;
+
+    static DocumentID readVarint(const unsigned char *&p) {
+        DocumentID result = 0;
+        int shift = 0;
+        while(*p & 0x80) {
+            result |= ((DocumentID)(*p++ & 0x7F)) << shift;
+            shift += 7;
+        }
+        result |= ((DocumentID)*p++) << shift;
+        return result;
+    }
+    void append(const DocumentID id);
+    void reserve(const size_t bytes);
+    void skipEntry(const size_t i, DocumentID &value, uint32_t &offset) const;
+    void buildSkipTable();
+    void clear();
+    void checkFinalized() const;
+    Iterator first() const;
+
+public:
+    PostingList();
+    ~PostingList();
+    PostingList(const PostingList &other);
+    PostingList(PostingList &&other);
+    PostingList& operator=(PostingList other);
+    void swap(PostingList &other);
+
+    void add(const DocumentID id);
+    void finalize();
+
+    size_t size() const;
+    bool contains(const DocumentID id) const;
+    Iterator begin() const;
+    size_t memoryUsage() const;
+
+    /*
+     * Calls f(id) for every ID in both lists in increasing order.
+     * The longer list is skipped through rather than decoded.
+     */
+    template<typename F>
+    static void intersect(const PostingList &a, const PostingList &b, F f) {
+        const PostingList &shorter = a.size() <= b.size() ? a : b;
+        const PostingList &longer = a.size() <= b.size() ? b : a;
+        Iterator j = longer.begin();
+        for(Iterator i = shorter.begin(); !i.atEnd(); i.next()) {
+            j.skipTo(i.get());
+            if(j.atEnd())
+                return;
+            if(j.get() == i.get())
+                f(i.get());
+        }
+    }
+};
+
+COL_NAMESPACE_END
+
+#endif /* POSTINGLIST_HH_ */
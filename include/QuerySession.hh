@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QUERYSESSION_HH_
+#define QUERYSESSION_HH_
+
+#include "ColumbusCore.hh"
+
+COL_NAMESPACE_START
+
+struct QuerySessionPrivate;
+class IncrementalSearch;
+class ErrorValues;
+
+/**
+ * Search state carried from one onlineMatch query to the next.
+ *
+ * Pass the same session to Matcher::onlineMatch for every keystroke of
+ * one query being typed. Every query word keeps an incremental search
+ * per field, so when a word only grows at the end the previous search
+ * is continued instead of started from scratch. Results are the same
+ * as without a session.
+ *
+ * A session notices when it is used with a different matcher or after
+ * the matcher has been reindexed or its error values fetched for
+ * changing, and starts over. Sessions are not thread safe, use one per
+ * typing user.
+ */
+class COL_PUBLIC QuerySession final {
+    friend class Matcher;
+
+private:
+    QuerySessionPrivate *p;
+
+    void bind(const size_t generation);
+    IncrementalSearch& getSearch(const size_t word, const WordID indexID, const ErrorValues &e);
+
+public:
+    QuerySession();
+    ~QuerySession();
+    QuerySession(const QuerySession &other) = delete;
+    const QuerySession & operator=(const QuerySession &other) = delete;
+
+    void reset();
+};
+
+COL_NAMESPACE_END
+
+#endif /* QUERYSESSION_HH_ */
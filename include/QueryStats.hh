@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QUERYSTATS_HH_
+#define QUERYSTATS_HH_
+
+#include "ColumbusCore.hh"
+
+COL_NAMESPACE_START
+
+struct QueryStatsPrivate;
+class Word;
+
+/*
+ * Counters and timings of what queries cost. Attach one to the
+ * SearchParameters of a query and the matcher adds to it as the query
+ * runs. Nothing is reset between queries, call clear() for that. The
+ * add functions are meant for the matcher. A QueryStats must only be
+ * used by one query at a time.
+ */
+class COL_PUBLIC QueryStats final {
+private:
+    QueryStatsPrivate *p;
+
+public:
+    QueryStats();
+    ~QueryStats();
+    QueryStats(const QueryStats &other) = delete;
+    const QueryStats & operator=(const QueryStats &other) = delete;
+
+    void clear();
+
+    void addIndexSearch(const Word &queryWord, const Word &field, const size_t nodesVisited,
+            const size_t cellsComputed, const size_t candidates);
+    void addPostingsScanned(const size_t postings);
+    void addDocumentsScored(const size_t documents);
+    void addDocumentsFiltered(const size_t documents);
+    void addTimes(const double indexMatch, const double gather, const double results);
+
+    // Trie nodes the error tolerant searches went through.
+    size_t getNodesVisited() const;
+    size_t getNodesVisited(const Word &field) const;
+    // Edit distance matrix cells evaluated on the way.
+    size_t getCellsComputed() const;
+    // Words matched in all fields for the given query word.
+    size_t getCandidateWords(const Word &queryWord) const;
+    // Document entries read from the posting lists of matched words.
+    size_t getPostingsScanned() const;
+    // Distinct documents that got a relevancy.
+    size_t getDocumentsScored() const;
+    // Scored documents dropped by the result filter.
+    size_t getDocumentsFiltered() const;
+    // Seconds spent in each phase of the query.
+    double getIndexMatchTime() const;
+    double getGatherTime() const;
+    double getResultTime() const;
+};
+
+COL_NAMESPACE_END
+
+#endif /* QUERYSTATS_HH_ */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROWKERNEL_HH_
+#define ROWKERNEL_HH_
+
+#include "ColumbusCore.hh"
+
+/*
+ * Evaluation of one row of LevenshteinIndex's weighted error matrix.
+ *
+ * Apart from insertions every cell only depends on the previous rows, so
+ * those are computed for many query positions at once. Insertions form
+ * a dependency chain along the row. It is resolved with a prefix minimum
+ * scan over row[j] - j*insertionError, which turns the chain into a
+ * logarithmic number of vector operations.
+ *
+ * The implementation is chosen at runtime based on what the CPU supports.
+ */
+
+COL_NAMESPACE_START
+
+struct ErrorRowInput {
+    const int *previous;         // Row depth-1.
+    const int *beforePrevious;   // Row depth-2 or null when on the first row.
+    const int *substituteErrors; // Cost of substituting query[i] with letter.
+    const Letter *query;
+    size_t queryLength;
+    Letter letter;
+    Letter previousLetter;
+    int insertionError;
+    int deletionError;
+    int endDeletionError;
+    int transposeError;
+};
+
+enum RowKernelType {
+    SCALAR_ROW_KERNEL,
+    SSE41_ROW_KERNEL,
+    AVX2_ROW_KERNEL,
+};
+
+/*
+ * Fills row[1] to row[queryLength]. Row[0] must already be set.
+ */
+typedef void (*ErrorRowFunction)(const ErrorRowInput &in, int *row);
+
+/*
+ * Writes lutRow[query[i]] to errors[i]. Returns false without finishing
+ * if some letter is outside the table.
+ */
+typedef bool (*SubstituteGatherFunction)(const int *lutRow, const size_t lutLetters,
+        const Letter *query, const size_t length, int *errors);
+
+// Returns null if the CPU can not run the given kernel.
+ErrorRowFunction getErrorRowFunction(const RowKernelType type);
+SubstituteGatherFunction getSubstituteGatherFunction(const RowKernelType type);
+
+RowKernelType bestRowKernel();
+void evaluateErrorRow(const ErrorRowInput &in, int *row);
+bool gatherSubstituteErrors(const int *lutRow, const size_t lutLetters,
+        const Letter *query, const size_t length, int *errors);
+
+COL_NAMESPACE_END
+
+#endif /* ROWKERNEL_HH_ */
@@ -27,6 +27,7 @@ COL_NAMESPACE_START
 struct SearchParametersPrivate;
 class Word;
 class ResultFilter;
+class QueryStats;
 
 class COL_PUBLIC SearchParameters final {
 private:
@@ -47,6 +48,29 @@ public:
     bool isNonsearchingField(const Word &w) const;
 
     int looseningIterations() const;
+
+    /*
+     * Only return this many of the most relevant results. Zero,
+     * the default, returns every result.
+     */
+    void setMaxResults(size_t maxResults);
+    size_t getMaxResults() const;
+
+    /*
+     * Treat the last query word as the start of a word that is still
+     * being typed and match the most common completions of it. See
+     * LevenshteinIndex::findCompletions. Off by default.
+     */
+    void setLastWordPrefix(bool prefix);
+    bool isLastWordPrefix() const;
+
+    /*
+     * Collect counters and timings of queries made with these
+     * parameters into the given object, see QueryStats.hh. The caller
+     * keeps ownership. Null, the default, turns collection off.
+     */
+    void setQueryStats(QueryStats *stats);
+    QueryStats* getQueryStats() const;
 };
 
 COL_NAMESPACE_END
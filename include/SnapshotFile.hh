@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOTFILE_HH_
+#define SNAPSHOTFILE_HH_
+
+#include "ColumbusCore.hh"
+#include <string>
+
+/*
+ * Helpers for the files that make up a Matcher snapshot.
+ *
+ * A snapshot file is a small header followed by a sequence of blocks.
+ * A block is a raw array prefixed by its size in bytes. Every block starts
+ * at an eight byte boundary so the reader can hand out pointers straight
+ * into the mapped file instead of copying.
+ */
+
+COL_NAMESPACE_START
+
+struct SnapshotWriterPrivate;
+struct SnapshotReaderPrivate;
+
+class SnapshotWriter final {
+private:
+    SnapshotWriterPrivate *p;
+
+public:
+    SnapshotWriter(const std::string &path, const char *type);
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter &other) = delete;
+    const SnapshotWriter & operator=(const SnapshotWriter &other) = delete;
+
+    void writeBlock(const void *data, const size_t bytes);
+    void writeValue(const uint64_t value);
+    template<typename T> void writeArray(const T *data, const size_t count) {
+        writeBlock(data, count*sizeof(T));
+    }
+    // The file only appears under its real name once this has been called.
+    void finish();
+};
+
+class SnapshotReader final {
+private:
+    SnapshotReaderPrivate *p;
+
+public:
+    SnapshotReader(const std::string &path, const char *type);
+    ~SnapshotReader();
+    SnapshotReader(const SnapshotReader &other) = delete;
+    const SnapshotReader & operator=(const SnapshotReader &other) = delete;
+
+    // Returned pointers are valid for as long as the reader exists.
+    const void* readBlock(size_t &count, const size_t elementSize);
+    uint64_t readValue();
+    template<typename T> const T* readArray(size_t &count) {
+        return static_cast<const T*>(readBlock(count, sizeof(T)));
+    }
+};
+
+COL_NAMESPACE_END
+
+#endif /* SNAPSHOTFILE_HH_ */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADPOOL_HH_
+#define THREADPOOL_HH_
+
+#include "ColumbusCore.hh"
+
+/*
+ * A fixed set of worker threads for splitting work into independent
+ * tasks. Any number of threads may call run() at the same time. The
+ * calling thread works on its own tasks too, so a pool of size N has
+ * N-1 background threads.
+ */
+
+COL_NAMESPACE_START
+
+struct ThreadPoolPrivate;
+
+class ThreadTask {
+public:
+    virtual ~ThreadTask() {}
+    /*
+     * Called once for every task number. The worker number is below
+     * ThreadPool::size() and no two tasks of the same run() are executed
+     * concurrently with the same worker number, so it can be used to
+     * pick per-thread scratch data.
+     */
+    virtual void execute(const size_t task, const size_t worker) = 0;
+};
+
+class ThreadPool final {
+private:
+    ThreadPoolPrivate *p;
+
+    void workerLoop(const size_t worker);
+
+public:
+    explicit ThreadPool(const size_t numThreads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &other) = delete;
+    const ThreadPool & operator=(const ThreadPool &other) = delete;
+
+    size_t size() const;
+    /*
+     * Returns once all tasks are done. If a task throws, the remaining
+     * ones are skipped and the first exception is rethrown here.
+     */
+    void run(ThreadTask &task, const size_t numTasks);
+};
+
+COL_NAMESPACE_END
+
+#endif /* THREADPOOL_HH_ */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOKENIZER_HH_
+#define TOKENIZER_HH_
+
+#include "ColumbusCore.hh"
+
+/*
+ * Splits UTF-8 text into words in a single pass.
+ *
+ * The whole text is decoded once into one letter buffer and each token
+ * is a span of that buffer. The buffers are kept between calls, so
+ * tokenizing a stream of documents with one Tokenizer does not allocate
+ * anything per token. word() and appendTo() build Words, which do, so
+ * callers that only look tokens up should use the spans.
+ */
+
+COL_NAMESPACE_START
+
+class Word;
+class WordList;
+struct TokenizerPrivate;
+
+struct TokenSpan {
+    unsigned int offset;
+    unsigned int length;
+};
+
+class Tokenizer final {
+private:
+    TokenizerPrivate *p;
+
+public:
+    Tokenizer();
+    ~Tokenizer();
+    Tokenizer(const Tokenizer &other) = delete;
+    const Tokenizer & operator=(const Tokenizer &other) = delete;
+
+    // Splits on the letters isWhitespace() accepts.
+    void tokenize(const char *utf8Text);
+    void tokenize(const char *utf8Text, const Letter *splitChars, int numChars);
+
+    size_t size() const;
+    const TokenSpan& operator[](const size_t i) const;
+    // Valid until the next call to tokenize.
+    const Letter* letters() const;
+    Word word(const size_t i) const;
+    void appendTo(WordList &list) const;
+};
+
+COL_NAMESPACE_END
+
+#endif /* TOKENIZER_HH_ */
@@ -25,15 +25,21 @@
 COL_NAMESPACE_START
 
 struct TriePrivate;
+struct TrieLayout;
 class Word;
 
 class Trie final {
 private:
     TriePrivate *p;
     void expand();
+    void makeWritable();
     TrieOffset append(const char *data, const int size);
     TrieOffset addNewSibling(const TrieOffset node, const TrieOffset sibling, Letter l);
     TrieOffset addNewNode(const TrieOffset parent);
+    TrieOffset findSibling(const TrieOffset node, const Letter l) const;
+    void collectLayout(TrieLayout &layout) const;
+    void writeFrozen(const TrieLayout &layout);
+    void writeSuccinct(const TrieLayout &layout);
 
 public:
     Trie();
@@ -57,8 +63,37 @@ public:
 
     size_t numWords() const;
     size_t numNodes() const;
+    // Size of the mapping, which is how much the trie occupies in memory.
+    size_t memoryUsage() const;
 
     Word getWord(const TrieOffset startNode) const;
+
+    /*
+     * Persistence. A saved trie can be mapped back in with openReadOnly,
+     * which replaces the current contents of this object. The mapping is
+     * shared with the page cache, so opening is nearly free. Modifying a
+     * read-only trie first copies it to private storage.
+     */
+    void save(const char *path) const;
+    void openReadOnly(const char *path);
+    bool isReadOnly() const;
+
+    /*
+     * Rewrites the trie so that the children of every node are stored
+     * right after it, sorted by letter. Lookups get faster but all
+     * previously returned offsets become invalid. The trie stays frozen
+     * until a word that needs new nodes is inserted.
+     */
+    void freeze();
+    bool isFrozen() const;
+    /*
+     * Replaces the trie with a much smaller read-only encoding, see
+     * Trie.cc. Traversal works as before but with different offsets,
+     * and each step costs a little more. Inserting words afterwards
+     * first expands the trie to the frozen layout.
+     */
+    void makeSuccinct();
+    bool isSuccinct() const;
 };
 
 COL_NAMESPACE_END
@@ -30,17 +30,25 @@ COL_NAMESPACE_START
  * there is no whitespace in it.
  *
  * A word's contents are immutable.
+ *
+ * The letters live in a reference counted buffer that is shared
+ * between copies, so copying a word never allocates memory. Building
+ * a word allocates its buffer once. Matcher::addText() only builds
+ * words for tokens it has not seen before.
  */
 class COL_PUBLIC Word final {
 private:
 
-    Letter *text; // Change this to a shared pointer to save memory.
+    Letter *text; // Points into a shared buffer, see Word.cc.
     unsigned int len;
 
     bool hasWhitespace();
     bool hasBrokenSurrogates();
     void duplicateFrom(const Word &w);
+    void moveFrom(Word &w);
     void convertString(const char *utf8Word);
+    Letter* allocate(const unsigned int length);
+    void release();
 
 public:
     Word();
@@ -49,6 +57,7 @@ public:
     Word(const std::string &w);
     explicit Word(const char *utf8Word);
     explicit Word(Letter *letters, size_t length);
+    explicit Word(const Letter *letters, size_t length);
     ~Word();
 
     unsigned int length() const { return len;}
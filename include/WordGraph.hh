@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORDGRAPH_HH_
+#define WORDGRAPH_HH_
+
+#include "ColumbusCore.hh"
+#include "Trie.hh"
+#include "Dawg.hh"
+
+/*
+ * Lets the searches of LevenshteinIndex walk either its trie or its word
+ * graph with the same code. The branch is taken the same way for the
+ * whole search, so it is practically free.
+ */
+
+COL_NAMESPACE_START
+
+class WordGraph final {
+private:
+    const Trie *trie;
+    const Dawg *dawg;
+
+public:
+    WordGraph() : trie(nullptr), dawg(nullptr) {}
+    void setTrie(const Trie *t) { trie = t; dawg = nullptr; }
+    void setDawg(const Dawg *d) { trie = nullptr; dawg = d; }
+
+    GraphOffset getRoot() const { return dawg ? dawg->getRoot() : trie->getRoot(); }
+    GraphOffset getSiblingList(const GraphOffset node) const {
+        return dawg ? dawg->getSiblingList(node) : trie->getSiblingList((TrieOffset)node);
+    }
+    GraphOffset getNextSibling(const GraphOffset sibling) const {
+        return dawg ? dawg->getNextSibling(sibling) : trie->getNextSibling((TrieOffset)sibling);
+    }
+    Letter getLetter(const GraphOffset sibling) const {
+        return dawg ? dawg->getLetter(sibling) : trie->getLetter((TrieOffset)sibling);
+    }
+    GraphOffset getChild(const GraphOffset sibling) const {
+        return dawg ? dawg->getChild(sibling) : trie->getChild((TrieOffset)sibling);
+    }
+    WordID getWordID(const GraphOffset node) const {
+        return dawg ? dawg->getWordID(node) : trie->getWordID((TrieOffset)node);
+    }
+};
+
+COL_NAMESPACE_END
+
+#endif /* WORDGRAPH_HH_ */
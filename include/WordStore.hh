@@ -21,6 +21,7 @@
 #define WORDSTORE_HH_
 
 #include "ColumbusCore.hh"
+#include <string>
 
 COL_NAMESPACE_START
 
@@ -40,6 +41,7 @@ class COL_PUBLIC WordStore final {
 private:
 
     WordStorePrivate *p;
+    void findNodes();
 
 public:
     WordStore();
@@ -49,9 +51,21 @@ public:
 
 
     WordID getID(const Word &w);
+    // Like getID but does not add unknown words. Returns INVALID_WORDID for them.
+    WordID findID(const Word &w) const;
     bool hasWord(const Word &w) const;
     Word getWord(const WordID id) const;
     bool hasWord(const WordID id) const;
+
+    // Compacts the word trie. New words can still be added afterwards.
+    void freeze();
+    // The same but with a succinct trie, see Trie.hh.
+    void compact();
+    // Bytes used by the word trie and the ID table.
+    size_t memoryUsage() const;
+
+    void save(const std::string &basename) const;
+    void load(const std::string &basename);
 };
 
 COL_NAMESPACE_END
@@ -42,5 +42,7 @@
 #include <ColumbusHelpers.hh>
 #include <IndexWeights.hh>
 #include <ErrorValues.hh>
+#include <QuerySession.hh>
+#include <MemoryUsage.hh>
 
 #endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BitVector.hh"
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+COL_NAMESPACE_START
+using namespace std;
+
+/*
+ * The image is a header followed by the bit words, the rank table and
+ * the select samples. Everything is a multiple of eight bytes so images
+ * can be placed one after the other.
+ */
+struct BitVectorHeader {
+    uint64_t numBits;
+    uint64_t numOnes;
+    uint64_t numOneSamples;
+    uint64_t numZeroSamples;
+};
+
+static size_t numWords(const size_t numBits) {
+    return (numBits + 63) / 64;
+}
+
+static size_t imageBytes(const BitVectorHeader &h) {
+    const size_t tables = (numWords(h.numBits) + 1 + h.numOneSamples + h.numZeroSamples) * sizeof(uint32_t);
+    return sizeof(BitVectorHeader) + numWords(h.numBits) * sizeof(uint64_t) + (tables + 7) / 8 * 8;
+}
+
+BitVector::BitVector() : bits(nullptr), ranks(nullptr), oneSamples(nullptr), zeroSamples(nullptr),
+    numBits(0), numOnes(0) {
+}
+
+static size_t numSamples(const size_t count) {
+    return (count + BitVector::SELECT_SAMPLE - 1) / BitVector::SELECT_SAMPLE;
+}
+
+size_t BitVector::imageSize(const size_t numBits, const size_t numOnes) {
+    BitVectorHeader h;
+    if(numOnes > UINT32_MAX)
+        throw overflow_error("Bit vector is too large.");
+    h.numBits = numBits;
+    h.numOnes = numOnes;
+    h.numOneSamples = numSamples(numOnes);
+    h.numZeroSamples = numSamples(numBits - numOnes);
+    return imageBytes(h);
+}
+
+void BitVector::build(const uint64_t *source, const size_t numBits, void *image) {
+    const size_t words = numWords(numBits);
+    char *out = (char*)image;
+    BitVectorHeader h;
+    size_t ones = 0;
+    // Bits past the end may be set in the last word.
+    for(size_t i=0; i<numBits; i+=64) {
+        const uint64_t mask = numBits - i >= 64 ? ~(uint64_t)0 : (((uint64_t)1) << (numBits - i)) - 1;
+        ones += __builtin_popcountll(source[i/64] & mask);
+    }
+    if(ones > UINT32_MAX)
+        throw overflow_error("Bit vector is too large.");
+    h.numBits = numBits;
+    h.numOnes = ones;
+    h.numOneSamples = numSamples(ones);
+    h.numZeroSamples = numSamples(numBits - ones);
+    memset(out, 0, imageBytes(h));
+    memcpy(out, &h, sizeof(h));
+    uint64_t *bitWords = (uint64_t*)(out + sizeof(h));
+    uint32_t *ranks = (uint32_t*)(bitWords + words);
+    uint32_t *oneSamples = ranks + words + 1;
+    uint32_t *zeroSamples = oneSamples + h.numOneSamples;
+    ones = 0;
+    for(size_t i=0; i<numBits; i++) {
+        if(i % 64 == 0)
+            ranks[i/64] = ones;
+        if((source[i/64] >> (i%64)) & 1) {
+            if(ones % SELECT_SAMPLE == 0)
+                *oneSamples++ = i/64;
+            bitWords[i/64] |= ((uint64_t)1) << (i%64);
+            ones++;
+        } else {
+            if((i - ones) % SELECT_SAMPLE == 0)
+                *zeroSamples++ = i/64;
+        }
+    }
+    ranks[words] = ones;
+}
+
+size_t BitVector::attach(const void *image, const size_t maxBytes) {
+    const char *in = (const char*)image;
+    BitVectorHeader h;
+    if(maxBytes < sizeof(h))
+        throw runtime_error("Bit vector image is truncated.");
+    memcpy(&h, in, sizeof(h));
+    if(h.numOnes > h.numBits || h.numOneSamples > numWords(h.numBits) + 1 ||
+            h.numZeroSamples > numWords(h.numBits) + 1 || imageBytes(h) > maxBytes)
+        throw runtime_error("Bit vector image is truncated.");
+    const size_t words = numWords(h.numBits);
+    bits = (const uint64_t*)(in + sizeof(h));
+    ranks = (const uint32_t*)(bits + words);
+    oneSamples = ranks + words + 1;
+    zeroSamples = oneSamples + h.numOneSamples;
+    numBits = h.numBits;
+    numOnes = h.numOnes;
+    return imageBytes(h);
+}
+
+size_t BitVector::selectInWord(uint64_t word, size_t k) {
+    while(k-- > 0)
+        word &= word - 1;
+    return __builtin_ctzll(word);
+}
+
+size_t BitVector::select1(const size_t k) const {
+    size_t w = oneSamples[k / SELECT_SAMPLE];
+    while(ranks[w+1] <= k)
+        w++;
+    return w*64 + selectInWord(bits[w], k - ranks[w]);
+}
+
+size_t BitVector::select0(const size_t k) const {
+    size_t w = zeroSamples[k / SELECT_SAMPLE];
+    while((w+1)*64 - ranks[w+1] <= k)
+        w++;
+    return w*64 + selectInWord(~bits[w], k - (w*64 - ranks[w]));
+}
+
+COL_NAMESPACE_END
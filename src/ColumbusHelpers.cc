@@ -24,6 +24,7 @@
 #include "ColumbusHelpers.hh"
 #include "Word.hh"
 #include "WordList.hh"
+#include "Tokenizer.hh"
 #include <iconv.h>
 #include <cstdio>
 #include <cerrno>
@@ -36,36 +37,120 @@
 
 COL_NAMESPACE_START
 
-static const Letter whitespaceLetters[] = {' ', '\t', '\n', '\r', '\0'};
-static const int numWhitespaceLetters = 4;
+/*
+ * Simple lower case mappings for the Basic Multilingual Plane. Filled
+ * from ICU on first use because towlower from libc does not work.
+ */
+static const uint16_t* buildLowerTable() {
+    static uint16_t table[0x10000];
+    for(uint32_t i=0; i<0x10000; i++) {
+        UChar32 lower = u_tolower(i);
+        table[i] = lower <= 0xFFFF ? lower : i;
+    }
+    return table;
+}
 
 static Letter lowerLetter(Letter l) {
-    return Letter(u_tolower(l)); // Have to use ICU because towlower libc function does not work.
+    static const uint16_t *lowerTable = buildLowerTable();
+    uint32_t c = l;
+    if(c < 0x10000)
+        return Letter(lowerTable[c]);
+    return Letter(u_tolower(c));
+}
+
+static Letter lowerAscii(const unsigned char c) {
+    return Letter(c | ((unsigned char)(c - 'A') < 26 ? 0x20 : 0));
 }
 
-Letter* utf8ToInternal(const char *utf8Text, unsigned int &resultStringSize) {
+/*
+ * Decodes UTF-8 directly into lower case letters. Returns false if the
+ * input is not valid so the caller can fall back to iconv.
+ */
+static bool decodeUtf8(const unsigned char *in, const size_t bytes, Letter *out, unsigned int &resultStringSize) {
+    size_t i = 0;
+    unsigned int o = 0;
+    while(i < bytes) {
+        // Plain ASCII text is by far the most common case, so check it
+        // eight bytes at a time.
+        while(i + sizeof(uint64_t) <= bytes) {
+            uint64_t chunk;
+            memcpy(&chunk, in + i, sizeof(chunk));
+            if(chunk & 0x8080808080808080ULL)
+                break;
+            for(size_t j=0; j<sizeof(chunk); j++)
+                out[o++] = lowerAscii(in[i+j]);
+            i += sizeof(chunk);
+        }
+        if(i >= bytes)
+            break;
+        uint32_t c = in[i];
+        if(c < 0x80) {
+            out[o++] = lowerAscii(c);
+            i++;
+            continue;
+        }
+        size_t extra;
+        uint32_t minimum;
+        if((c & 0xE0) == 0xC0) {
+            extra = 1;
+            c &= 0x1F;
+            minimum = 0x80;
+        } else if((c & 0xF0) == 0xE0) {
+            extra = 2;
+            c &= 0x0F;
+            minimum = 0x800;
+        } else if((c & 0xF8) == 0xF0) {
+            extra = 3;
+            c &= 0x07;
+            minimum = 0x10000;
+        } else {
+            return false;
+        }
+        if(i + extra >= bytes)
+            return false;
+        for(size_t j=1; j<=extra; j++) {
+            uint32_t cont = in[i+j];
+            if((cont & 0xC0) != 0x80)
+                return false;
+            c = (c << 6) | (cont & 0x3F);
+        }
+        if(c < minimum || c > 0x10FFFF || (c >= 0xD800 && c < 0xE000))
+            return false;
+        i += extra + 1;
+        if(sizeof(Letter) == 2 && c >= 0x10000) {
+            // Surrogate halves are never case mapped.
+            c -= 0x10000;
+            out[o++] = Letter(static_cast<Letter_>(0xD800 + (c >> 10)));
+            out[o++] = Letter(static_cast<Letter_>(0xDC00 + (c & 0x3FF)));
+        } else {
+            out[o++] = lowerLetter(Letter(static_cast<Letter_>(c)));
+        }
+    }
+    out[o] = 0;
+    resultStringSize = o;
+    return true;
+}
+
+static unsigned int iconvToInternal(const char *utf8Text, const size_t inputLen, Letter *result) {
     iconv_t ic = iconv_open(INTERNAL_ENCODING, "UTF-8");
     char *tmp;
-    char *txt;
     char *inBuf;
     char *outBuf;
     size_t badConvertedCharacters;
     size_t inBytes, outBytes, outBytesOriginal;
-    size_t bytesWritten;
+    unsigned int resultStringSize;
     if (ic == (iconv_t)-1) {
         throw std::runtime_error("Could not create iconv converter.");
     }
 
-    unsigned int inputLen = strlen((const char*)(utf8Text));
-    txt = (char*)new Letter[inputLen+1];
     tmp = strdup((const char*)(utf8Text)); // Iconv should take a const pointer but does not. Protect against it screwing up.
     assert(tmp);
     inBytes = inputLen;
-    outBytes = sizeof(Letter)*(inBytes+1);
+    outBytes = sizeof(Letter)*inBytes;
     outBytesOriginal = outBytes;
 
     inBuf = tmp;
-    outBuf = txt;
+    outBuf = reinterpret_cast<char*>(result);
     badConvertedCharacters = iconv(ic, &inBuf, &inBytes, &outBuf, &outBytes);
     free(tmp);
     iconv_close(ic);
@@ -74,27 +159,28 @@ Letter* utf8ToInternal(const char *utf8Text, unsigned int &resultStringSize) {
         err += (const char*)(utf8Text);
         throw std::runtime_error(err);
     }
-    bytesWritten = outBytesOriginal - outBytes;
-    resultStringSize = bytesWritten/sizeof(Letter);
-
-    if(bytesWritten < inputLen) {
-        // Shrink allocated memory size to exactly the produced string.
-        size_t newArraySize = bytesWritten + sizeof(Letter);
-        char *newtxt = new char[newArraySize];
-        memcpy(newtxt, txt, newArraySize);
-        delete []txt;
-        txt = newtxt;
-    }
-    Letter* text = reinterpret_cast<Letter*>(txt);
-    text[resultStringSize] = 0; // Null terminated.
+    resultStringSize = (outBytesOriginal - outBytes)/sizeof(Letter);
+    result[resultStringSize] = 0; // Null terminated.
     // Now convert all letters to lower case, because we don't care about case difference when matching.
     for(size_t i=0; i<resultStringSize; i++) {
-        text[i] = lowerLetter(text[i]);
+        result[i] = lowerLetter(result[i]);
     }
-    return text;
+    return resultStringSize;
 }
 
-void internalToUtf8(const Letter* source, unsigned int characters, char *buf, unsigned int bufsize) {
+/*
+ * Converts the given number of UTF-8 bytes to lower case letters in
+ * the internal encoding and returns the number of letters written.
+ * The result buffer must have room for bytes+1 letters.
+ */
+unsigned int utf8ToInternal(const char *utf8Text, const size_t bytes, Letter *result) {
+    unsigned int resultStringSize;
+    if(decodeUtf8(reinterpret_cast<const unsigned char*>(utf8Text), bytes, result, resultStringSize))
+        return resultStringSize;
+    return iconvToInternal(utf8Text, bytes, result);
+}
+
+static void iconvToUtf8(const Letter* source, unsigned int characters, char *buf, unsigned int bufsize) {
     iconv_t ic = iconv_open("UTF-8", INTERNAL_ENCODING);
     char *inBuf = reinterpret_cast<char*>(const_cast<Letter*>(source));
     char *outBuf;
@@ -118,6 +204,60 @@ void internalToUtf8(const Letter* source, unsigned int characters, char *buf, un
     buf[resultStringSize] = 0; // Null terminated, just in case.
 }
 
+/*
+ * Encodes letters as UTF-8. Returns false on broken surrogates or if
+ * the buffer is too small, in which case iconv produces the error.
+ */
+static bool encodeUtf8(const Letter *source, unsigned int characters, char *buf, unsigned int bufsize) {
+    unsigned int o = 0;
+    for(unsigned int i=0; i<characters; i++) {
+        uint32_t c = source[i];
+        if(c >= 0xD800 && c < 0xE000) {
+            if(c >= 0xDC00 || i+1 >= characters)
+                return false;
+            uint32_t low = source[i+1];
+            if(low < 0xDC00 || low >= 0xE000)
+                return false;
+            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+            i++;
+        }
+        if(c < 0x80) {
+            if(o + 1 >= bufsize)
+                return false;
+            buf[o++] = c;
+        } else if(c < 0x800) {
+            if(o + 2 >= bufsize)
+                return false;
+            buf[o++] = 0xC0 | (c >> 6);
+            buf[o++] = 0x80 | (c & 0x3F);
+        } else if(c < 0x10000) {
+            if(o + 3 >= bufsize)
+                return false;
+            buf[o++] = 0xE0 | (c >> 12);
+            buf[o++] = 0x80 | ((c >> 6) & 0x3F);
+            buf[o++] = 0x80 | (c & 0x3F);
+        } else if(c <= 0x10FFFF) {
+            if(o + 4 >= bufsize)
+                return false;
+            buf[o++] = 0xF0 | (c >> 18);
+            buf[o++] = 0x80 | ((c >> 12) & 0x3F);
+            buf[o++] = 0x80 | ((c >> 6) & 0x3F);
+            buf[o++] = 0x80 | (c & 0x3F);
+        } else {
+            return false;
+        }
+    }
+    if(bufsize == 0)
+        return false;
+    buf[o] = 0;
+    return true;
+}
+
+void internalToUtf8(const Letter* source, unsigned int characters, char *buf, unsigned int bufsize) {
+    if(!encodeUtf8(source, characters, buf, bufsize))
+        iconvToUtf8(source, characters, buf, bufsize);
+}
+
 double hiresTimestamp() {
     struct timeval now;
     gettimeofday(&now, NULL);
@@ -126,60 +266,23 @@ double hiresTimestamp() {
 }
 
 WordList splitToWords(const char *utf8Text) {
-    return split(utf8Text, whitespaceLetters, numWhitespaceLetters);
-}
-
-static bool isInList(const Letter l, const Letter *chars, int numChars) {
-    for(int i=0; i<numChars;i++)
-        if(chars[i] == l)
-            return true;
-    return false;
+    WordList list;
+    Tokenizer t;
+    t.tokenize(utf8Text);
+    t.appendTo(list);
+    return list;
 }
 
 WordList split(const char *utf8Text, const Letter *splitChars, int numChars) {
     WordList list;
-    unsigned int strSize = strlen(utf8Text);
-    size_t begin, end;
-    end = 0;
-    char *word = 0;
-    unsigned int bufSize = 0;
-
-    do {
-        begin = end;
-        while(isInList(utf8Text[begin], splitChars, numChars) && begin < strSize) {
-            begin++;
-        }
-        if(begin >= strSize) {
-            delete []word;
-            return list;
-        }
-        end = begin+1;
-        while(!isInList(utf8Text[end], splitChars, numChars) && end < strSize) {
-            end++;
-        }
-        // End points to one past the last letter.
-        unsigned int wordLen = end-begin;
-        if(wordLen +1 > bufSize) {
-            delete[] word;
-            word = new char[wordLen+1];
-            bufSize = wordLen + 1;
-        }
-        memcpy(word, utf8Text+begin, wordLen);
-        word[wordLen] = '\0';
-        try {
-            Word w(word);
-            list.addWord(w);
-        } catch(std::invalid_argument &ex) {
-            delete []word;
-            throw ex;
-        }
-    } while(end < strSize);
-    delete []word;
+    Tokenizer t;
+    t.tokenize(utf8Text, splitChars, numChars);
+    t.appendTo(list);
     return list;
 }
 
 bool isWhitespace(Letter l) {
-    return isInList(l, whitespaceLetters, numWhitespaceLetters);
+    return l == ' ' || l == '\t' || l == '\n' || l == '\r';
 }
 
 COL_NAMESPACE_END
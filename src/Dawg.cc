@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The graph is built bottom up from a trie. A node's children are done
+ * before the node itself, so two subtrees are identical exactly when
+ * their roots have the same end of word flag and the same edges to the
+ * same, already shared, nodes. A hash table keyed by that signature finds
+ * the earlier copy.
+ */
+
+#include "Dawg.hh"
+#include "Trie.hh"
+#include "Word.hh"
+#include "SnapshotFile.hh"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+COL_NAMESPACE_START
+using namespace std;
+
+struct DawgNode {
+    uint32_t firstEdge; // Zero if there are none.
+    uint32_t words; // Reachable from here, top bit set if the node ends a word.
+};
+
+struct DawgEdge {
+    Letter l;
+    uint32_t target; // Top bit set on the last edge of a node.
+};
+
+static const uint32_t FLAG = 0x80000000;
+
+struct DawgPrivate {
+    vector<DawgNode> nodes; // Node zero is not used.
+    vector<DawgEdge> edges; // Neither is edge zero.
+    vector<WordID> ids;
+    uint32_t root;
+
+    uint32_t wordsBelow(const uint32_t node) const { return nodes[node].words & ~FLAG; }
+    bool endsWord(const uint32_t node) const { return nodes[node].words & FLAG; }
+};
+
+struct DawgRegistry {
+    unordered_map<string, uint32_t> nodes;
+};
+
+static GraphOffset handle(const uint64_t rank, const uint32_t index) { return (rank << 32) | index; }
+static uint32_t index(const GraphOffset h) { return (uint32_t)h; }
+static uint64_t rank(const GraphOffset h) { return h >> 32; }
+
+Dawg::Dawg() {
+    p = new DawgPrivate();
+    clear();
+}
+
+Dawg::~Dawg() {
+    delete p;
+}
+
+void Dawg::clear() {
+    DawgNode empty;
+    DawgEdge unused;
+    empty.firstEdge = 0;
+    empty.words = 0;
+    unused.l = 0;
+    unused.target = FLAG;
+    p->nodes.assign(2, empty);
+    p->edges.assign(1, unused);
+    p->ids.clear();
+    p->root = 1;
+}
+
+static uint32_t addNode(DawgPrivate *p, const Trie &trie, const TrieOffset node, DawgRegistry &registry) {
+    vector<pair<Letter, TrieOffset> > children;
+    vector<DawgEdge> out;
+    const WordID wordID = trie.getWordID(node);
+    uint32_t words = 0;
+    if(wordID != INVALID_WORDID) {
+        // Words are numbered in the order they are met.
+        p->ids.push_back(wordID);
+        words = 1;
+    }
+    for(TrieOffset sibl = trie.getSiblingList(node); sibl; sibl = trie.getNextSibling(sibl))
+        children.push_back(make_pair(trie.getLetter(sibl), trie.getChild(sibl)));
+    sort(children.begin(), children.end());
+    for(const auto &c : children) {
+        DawgEdge e;
+        e.l = c.first;
+        e.target = addNode(p, trie, c.second, registry);
+        words += p->wordsBelow(e.target);
+        out.push_back(e);
+    }
+    if(words >= FLAG)
+        throw overflow_error("Too many words for a word graph.");
+    if(!out.empty())
+        out.back().target |= FLAG;
+
+    // Built field by field, the edges may have padding.
+    string signature(wordID != INVALID_WORDID ? "t" : "n");
+    for(const auto &e : out) {
+        signature.append((const char*)&e.l, sizeof(e.l));
+        signature.append((const char*)&e.target, sizeof(e.target));
+    }
+    auto it = registry.nodes.find(signature);
+    if(it != registry.nodes.end())
+        return it->second;
+
+    DawgNode n;
+    n.firstEdge = out.empty() ? 0 : p->edges.size();
+    n.words = words | (wordID != INVALID_WORDID ? FLAG : 0);
+    if(p->nodes.size() >= FLAG)
+        throw overflow_error("Too many nodes for a word graph.");
+    const uint32_t result = p->nodes.size();
+    p->nodes.push_back(n);
+    p->edges.insert(p->edges.end(), out.begin(), out.end());
+    registry.nodes[signature] = result;
+    return result;
+}
+
+void Dawg::build(const Trie &trie) {
+    DawgRegistry registry;
+    vector<DawgNode>().swap(p->nodes);
+    vector<DawgEdge>().swap(p->edges);
+    clear();
+    p->nodes.resize(1);
+    p->root = addNode(p, trie, trie.getRoot(), registry);
+    p->nodes.shrink_to_fit();
+    p->edges.shrink_to_fit();
+    p->ids.shrink_to_fit();
+}
+
+static void copyNode(const Dawg &dawg, const GraphOffset node, vector<Letter> &prefix, Trie &trie) {
+    const WordID wordID = dawg.getWordID(node);
+    if(wordID != INVALID_WORDID) {
+        prefix.push_back(0);
+        trie.insertWord(Word(prefix.data(), prefix.size()), wordID);
+        prefix.pop_back();
+    }
+    for(GraphOffset sibl = dawg.getSiblingList(node); sibl; sibl = dawg.getNextSibling(sibl)) {
+        prefix.push_back(dawg.getLetter(sibl));
+        copyNode(dawg, dawg.getChild(sibl), prefix, trie);
+        prefix.pop_back();
+    }
+}
+
+void Dawg::copyTo(Trie &trie) const {
+    vector<Letter> prefix;
+    copyNode(*this, getRoot(), prefix, trie);
+}
+
+size_t Dawg::numNodes() const {
+    return p->nodes.size() - 1;
+}
+
+size_t Dawg::numWords() const {
+    return p->ids.size();
+}
+
+size_t Dawg::memoryUsage() const {
+    return p->nodes.capacity()*sizeof(DawgNode) + p->edges.capacity()*sizeof(DawgEdge) +
+            p->ids.capacity()*sizeof(WordID);
+}
+
+GraphOffset Dawg::getRoot() const {
+    return handle(0, p->root);
+}
+
+GraphOffset Dawg::getSiblingList(const GraphOffset node) const {
+    const uint32_t n = index(node);
+    if(p->nodes[n].firstEdge == 0)
+        return 0;
+    return handle(rank(node) + (p->endsWord(n) ? 1 : 0), p->nodes[n].firstEdge);
+}
+
+GraphOffset Dawg::getNextSibling(const GraphOffset sibling) const {
+    const DawgEdge &e = p->edges[index(sibling)];
+    if(e.target & FLAG)
+        return 0;
+    return handle(rank(sibling) + p->wordsBelow(e.target), index(sibling) + 1);
+}
+
+bool Dawg::hasSibling(const GraphOffset sibling) const {
+    return !(p->edges[index(sibling)].target & FLAG);
+}
+
+Letter Dawg::getLetter(const GraphOffset sibling) const {
+    return p->edges[index(sibling)].l;
+}
+
+GraphOffset Dawg::getChild(const GraphOffset sibling) const {
+    return handle(rank(sibling), p->edges[index(sibling)].target & ~FLAG);
+}
+
+WordID Dawg::getWordID(const GraphOffset node) const {
+    return p->endsWord(index(node)) ? p->ids[rank(node)] : INVALID_WORDID;
+}
+
+GraphOffset Dawg::findWord(const Word &word) const {
+    GraphOffset node = getRoot();
+    for(size_t i=0; i<word.length(); i++) {
+        // The word count has to be summed over the earlier edges anyway,
+        // so there is nothing to gain from a binary search.
+        GraphOffset sibl = getSiblingList(node);
+        while(sibl && getLetter(sibl) < word[i])
+            sibl = getNextSibling(sibl);
+        if(!sibl || getLetter(sibl) != word[i])
+            return 0;
+        node = getChild(sibl);
+    }
+    return node;
+}
+
+void Dawg::save(SnapshotWriter &out) const {
+    out.writeValue(p->root);
+    out.writeArray(p->nodes.data(), p->nodes.size());
+    out.writeArray(p->edges.data(), p->edges.size());
+    out.writeArray(p->ids.data(), p->ids.size());
+}
+
+void Dawg::load(SnapshotReader &in) {
+    size_t numNodes, numEdges, numIDs;
+    const uint64_t newRoot = in.readValue();
+    const DawgNode *newNodes = in.readArray<DawgNode>(numNodes);
+    const DawgEdge *newEdges = in.readArray<DawgEdge>(numEdges);
+    const WordID *newIDs = in.readArray<WordID>(numIDs);
+    bool ok = newRoot != 0 && newRoot < numNodes && numNodes < FLAG && numEdges > 0 &&
+            (newNodes[newRoot].words & ~FLAG) == numIDs && (newEdges[numEdges-1].target & FLAG);
+    for(size_t i=1; ok && i<numEdges; i++) {
+        const uint32_t target = newEdges[i].target & ~FLAG;
+        // Children always come before their parents.
+        ok = target != 0 && target < numNodes;
+    }
+    // Checking the word counts keeps lookups within the WordID table.
+    for(size_t i=1; ok && i<numNodes; i++) {
+        uint64_t words = (newNodes[i].words & FLAG) ? 1 : 0;
+        size_t e = newNodes[i].firstEdge;
+        ok = e < numEdges;
+        while(ok && e != 0) {
+            const uint32_t target = newEdges[e].target & ~FLAG;
+            ok = target < i;
+            if(ok)
+                words += newNodes[target].words & ~FLAG;
+            if(newEdges[e].target & FLAG)
+                break;
+            e++;
+        }
+        ok = ok && words == (newNodes[i].words & ~FLAG);
+    }
+    if(!ok)
+        throw runtime_error("Corrupt word graph.");
+    DawgPrivate *loaded = new DawgPrivate();
+    try {
+        loaded->nodes.assign(newNodes, newNodes + numNodes);
+        loaded->edges.assign(newEdges, newEdges + numEdges);
+        loaded->ids.assign(newIDs, newIDs + numIDs);
+    } catch(...) {
+        delete loaded;
+        throw;
+    }
+    loaded->root = newRoot;
+    delete p;
+    p = loaded;
+}
+
+COL_NAMESPACE_END
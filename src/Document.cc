@@ -55,7 +55,7 @@ void Document::addText(const Word &field, const WordList &words) {
 }
 
 void Document::addText(const Word &field, const char *textAsUtf8) {
-    addText(field, splitToWords(textAsUtf8));
+    p->texts[field] = splitToWords(textAsUtf8);
 }
 
 void Document::addText(const Word &field, const std::string &textAsUtf8) {
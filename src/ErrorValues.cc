@@ -31,6 +31,7 @@
 #include "ErrorValues.hh"
 #include "Word.hh"
 #include "ColumbusSlow.hh"
+#include "RowKernel.hh"
 
 COL_NAMESPACE_START
 using namespace std;
@@ -97,6 +98,32 @@ int ErrorValues::getSubstituteError(Letter l1, Letter l2) const {
     return substituteErrorSlow(l1, l2);
 }
 
+/*
+ * Substitution errors of one letter against a whole word, as used
+ * for a row of the error matrix.
+ */
+void ErrorValues::getSubstituteErrors(Letter l, const Letter *letters, const size_t length, int *errors) const {
+    if(l < LUT_LETTERS && gatherSubstituteErrors(p->lut + LUT_OFFSET(l, 0), LUT_LETTERS, letters, length, errors))
+        return;
+    for(size_t i=0; i<length; i++)
+        errors[i] = getSubstituteError(l, letters[i]);
+}
+
+/*
+ * True if every edit operation costs the same for a query term of the
+ * given length. In that case the error is simply the Damerau-Levenshtein
+ * distance times that cost and much faster algorithms can be used.
+ */
+bool ErrorValues::hasUniformErrors(const size_t queryTermLength) const {
+    if(!p->singleErrors.empty() || !p->groupErrors.empty())
+        return false;
+    return insertionError == substituteError &&
+            deletionError == substituteError &&
+            endDeletionError == substituteError &&
+            getStartInsertionError(queryTermLength) == substituteError &&
+            transposeError == substituteError;
+}
+
 int ErrorValues::substituteErrorSlow(Letter l1, Letter l2) const {
     if(l1 == l2)
         return 0;
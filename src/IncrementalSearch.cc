@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tracked nodes are kept in the order they were reached, which puts
+ * every node after its parent. A single pass over them in that order
+ * can then update the error columns, work out which nodes the search
+ * would reach and expand the ones that need it.
+ *
+ * A node is reached when its parent is the root or a reached node whose
+ * smallest error is within the maximum. Nodes that are no longer reached
+ * are kept, as a longer query may reach them again, but their columns
+ * are only brought up to date when that happens. Typing a letter then
+ * costs one column for each node a new search would visit.
+ */
+
+#include "IncrementalSearch.hh"
+#include "ErrorValues.hh"
+#include "IndexMatches.hh"
+#include "Word.hh"
+#include "WordGraph.hh"
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+COL_NAMESPACE_START
+using namespace std;
+
+static const uint32_t ROOT_NODE = 0;
+
+struct SearchNode {
+    GraphOffset node;
+    uint32_t parent;
+    uint32_t depth;
+    Letter letter;
+    bool expanded;
+    bool reached;
+    uint32_t length; // The query length the columns are up to date for.
+    int stableMin; // Smallest error in the columns that no longer change.
+};
+
+struct IncrementalSearchPrivate {
+    const ErrorValues *e;
+    const LevenshteinIndex *index; // The one searched last.
+    vector<Letter> query;
+    int startInsertionError;
+    vector<SearchNode> nodes;
+    vector<vector<int> > columns; // columns[j][k] is the error of node k at query position j.
+    size_t cellsComputed; // Running total over all searches.
+
+    int cellError(const size_t k, const size_t j) const;
+    bool isLive(const size_t k, const int maxError) const;
+    void addNode(const WordGraph &graph, const uint32_t parent, const GraphOffset sibling);
+    void restart(const Word &newQuery);
+    void extend(const Word &newQuery);
+    void update(const size_t k);
+};
+
+/*
+ * The same evaluation order as the row kernel: deletion and substitution
+ * from the parent, then a transposition from the grandparent and then an
+ * insertion from the previous query position.
+ */
+int IncrementalSearchPrivate::cellError(const size_t k, const size_t j) const {
+    const SearchNode &n = nodes[k];
+    const SearchNode &parent = nodes[n.parent];
+    const int deletionError = j == query.size() ? e->getEndDeletionError() : e->getDeletionError();
+    int error = min(columns[j][n.parent] + deletionError,
+            columns[j-1][n.parent] + e->getSubstituteError(n.letter, query[j-1]));
+    if(j >= 2 && n.depth >= 2 && query[j-1] == parent.letter && query[j-2] == n.letter)
+        error = min(error, columns[j-2][parent.parent] + e->getTransposeError());
+    return min(error, columns[j-1][k] + e->getInsertionError());
+}
+
+bool IncrementalSearchPrivate::isLive(const size_t k, const int maxError) const {
+    if(k == ROOT_NODE)
+        return true;
+    return min(nodes[k].stableMin, columns[query.size()][k]) <= maxError;
+}
+
+void IncrementalSearchPrivate::addNode(const WordGraph &graph, const uint32_t parent, const GraphOffset sibling) {
+    SearchNode n;
+    const size_t k = nodes.size();
+    n.node = graph.getChild(sibling);
+    n.parent = parent;
+    n.depth = nodes[parent].depth + 1;
+    n.letter = graph.getLetter(sibling);
+    n.expanded = false;
+    n.reached = false;
+    n.length = query.size();
+    n.stableMin = numeric_limits<int>::max();
+    nodes.push_back(n);
+    columns[0].push_back(n.depth*startInsertionError);
+    for(size_t j=1; j<columns.size(); j++)
+        columns[j].push_back(cellError(k, j));
+    cellsComputed += columns.size() - 1;
+    for(size_t j=0; j<query.size(); j++)
+        nodes[k].stableMin = min(nodes[k].stableMin, columns[j][k]);
+}
+
+void IncrementalSearchPrivate::restart(const Word &newQuery) {
+    SearchNode root;
+    query.clear();
+    for(size_t i=0; i<newQuery.length(); i++)
+        query.push_back(newQuery[i]);
+    startInsertionError = e->getStartInsertionError(query.size());
+    nodes.clear();
+    columns.assign(query.size()+1, vector<int>());
+    root.node = 0;
+    root.parent = ROOT_NODE;
+    root.depth = 0;
+    root.letter = 0;
+    root.expanded = false;
+    root.reached = true;
+    root.length = query.size();
+    root.stableMin = 0;
+    nodes.push_back(root);
+    for(size_t j=0; j<columns.size(); j++)
+        columns[j].push_back(j*e->getDeletionError());
+}
+
+/*
+ * Only the root gets its new cells here, the other nodes are updated
+ * by update() once the search reaches them.
+ */
+void IncrementalSearchPrivate::extend(const Word &newQuery) {
+    const size_t oldLength = query.size();
+    for(size_t i=oldLength; i<newQuery.length(); i++)
+        query.push_back(newQuery[i]);
+    columns.resize(query.size()+1);
+    for(size_t j=oldLength+1; j<columns.size(); j++) {
+        columns[j].resize(nodes.size());
+        columns[j][ROOT_NODE] = j*e->getDeletionError();
+    }
+    nodes[ROOT_NODE].length = query.size();
+}
+
+/*
+ * Evaluates the columns node k is missing. Its parent and grandparent
+ * must be up to date, which they are when they were reached first.
+ */
+void IncrementalSearchPrivate::update(const size_t k) {
+    const size_t oldLength = nodes[k].length;
+    if(oldLength == query.size())
+        return;
+    // The old last column was evaluated with the end deletion error.
+    if(oldLength > 0) {
+        columns[oldLength][k] = cellError(k, oldLength);
+        cellsComputed++;
+    }
+    nodes[k].stableMin = min(nodes[k].stableMin, columns[oldLength][k]);
+    for(size_t j=oldLength+1; j<columns.size(); j++)
+        columns[j][k] = cellError(k, j);
+    cellsComputed += columns.size() - oldLength - 1;
+    for(size_t j=oldLength+1; j<query.size(); j++)
+        nodes[k].stableMin = min(nodes[k].stableMin, columns[j][k]);
+    nodes[k].length = query.size();
+}
+
+IncrementalSearch::IncrementalSearch(const ErrorValues &e) {
+    p = new IncrementalSearchPrivate();
+    p->e = &e;
+    p->index = nullptr;
+    p->startInsertionError = 0;
+    p->cellsComputed = 0;
+}
+
+IncrementalSearch::~IncrementalSearch() {
+    delete p;
+}
+
+void IncrementalSearch::reset() {
+    p->index = nullptr;
+    p->query.clear();
+    p->nodes.clear();
+    p->columns.clear();
+}
+
+size_t IncrementalSearch::numNodes() const {
+    return p->nodes.empty() ? 0 : p->nodes.size() - 1;
+}
+
+void IncrementalSearch::search(const WordGraph &graph, const LevenshteinIndex *index, const Word &query,
+        const int maxError, IndexMatches &matches) {
+    const size_t cellsBefore = p->cellsComputed;
+    bool extends = index == p->index && query.length() >= p->query.size() &&
+            p->e->getStartInsertionError(query.length()) == p->startInsertionError;
+    for(size_t i=0; extends && i<p->query.size(); i++) {
+        if(query[i] != p->query[i])
+            extends = false;
+    }
+    if(!extends) {
+        p->index = index;
+        p->restart(query);
+    } else if(query.length() > p->query.size()) {
+        p->extend(query);
+    }
+
+    const size_t lastColumn = p->query.size();
+    for(size_t k=0; k<p->nodes.size(); k++) {
+        if(k != ROOT_NODE) {
+            const uint32_t parent = p->nodes[k].parent;
+            p->nodes[k].reached = p->nodes[parent].reached && p->isLive(parent, maxError);
+            if(!p->nodes[k].reached)
+                continue;
+            p->update(k);
+            matches.addWork(1, 0);
+            const int error = p->columns[lastColumn][k];
+            const WordID wordID = graph.getWordID(p->nodes[k].node);
+            if(error <= maxError && wordID != INVALID_WORDID)
+                matches.addMatch(query, wordID, error);
+        }
+        if(p->nodes[k].expanded || !p->isLive(k, maxError))
+            continue;
+        // Children go to the end, so this loop gets to them later.
+        const GraphOffset node = k == ROOT_NODE ? graph.getRoot() : p->nodes[k].node;
+        for(GraphOffset sibling = graph.getSiblingList(node); sibling != 0; sibling = graph.getNextSibling(sibling)) {
+            p->addNode(graph, k, sibling);
+        }
+        p->nodes[k].expanded = true;
+    }
+    matches.addWork(0, p->cellsComputed - cellsBefore);
+}
+
+COL_NAMESPACE_END
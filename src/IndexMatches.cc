@@ -40,10 +40,15 @@ struct MatchData {
 
 struct IndexMatchesPrivate {
     vector<MatchData> matches;
+    // How much work the searches that filled this did.
+    size_t nodesVisited;
+    size_t cellsComputed;
 };
 
 IndexMatches::IndexMatches() {
     p = new IndexMatchesPrivate();
+    p->nodesVisited = 0;
+    p->cellsComputed = 0;
 }
 
 IndexMatches::~IndexMatches() {
@@ -57,6 +62,11 @@ void IndexMatches::addMatch(const Word &/*queryWord*/, const WordID matchedWord,
     p->matches.push_back(m);
 }
 
+void IndexMatches::addWork(const size_t nodesVisited, const size_t cellsComputed) {
+    p->nodesVisited += nodesVisited;
+    p->cellsComputed += cellsComputed;
+}
+
 size_t IndexMatches::size() const {
     return p->matches.size();
 }
@@ -97,12 +107,23 @@ int IndexMatches::getMatchError(size_t num) const {
     return p->matches[num].error;
 }
 
+size_t IndexMatches::getNodesVisited() const {
+    return p->nodesVisited;
+}
+
+size_t IndexMatches::getCellsComputed() const {
+    return p->cellsComputed;
+}
+
 void IndexMatches::clear() {
     p->matches.clear();
+    p->nodesVisited = 0;
+    p->cellsComputed = 0;
 }
 
 void IndexMatches::sort() {
-    std::sort(p->matches.begin(), p->matches.end());
+    // Stable so that matches with equal error keep the order they were added in.
+    std::stable_sort(p->matches.begin(), p->matches.end());
 }
 
 COL_NAMESPACE_END
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A state consists of the clamped error row and the part of the previous
+ * row that can still be reached with a transposition, along with the
+ * letter that makes the transposition possible. Keeping only that part
+ * means states that behave identically compare equal.
+ *
+ * Interned states get consecutive ids. Once there are too many of them,
+ * new states live in a scratch slot for their depth and are not memoized.
+ * This works because the trie is walked depth first.
+ */
+
+#include "LevenshteinAutomaton.hh"
+#include "ErrorValues.hh"
+#include "Word.hh"
+#include "RowKernel.hh"
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef HAS_SPARSE_HASH
+#include <google/sparse_hash_map>
+using google::sparse_hash_map;
+#define hashmap sparse_hash_map
+#else
+#include <unordered_map>
+#define hashmap unordered_map
+#endif
+
+COL_NAMESPACE_START
+using namespace std;
+
+static const LevenshteinAutomaton::State SCRATCH_STATE = 0x80000000;
+static const LevenshteinAutomaton::State NO_STATE = 0xFFFFFFFF;
+
+struct LevenshteinAutomatonPrivate {
+    Word query;
+    vector<Letter> letters;
+    const ErrorValues &e;
+    int maxError;
+    int clampError;
+    int startInsertionError;
+    int uniformError;
+    size_t maxStates;
+    size_t stride; // Error row followed by transposition row.
+
+    vector<int> states;
+    vector<Letter> stateLetters;
+    vector<int> minErrors;
+    vector<LevenshteinAutomaton::State> lookup; // Open addressing on state contents.
+
+    vector<int> scratch;
+    vector<Letter> scratchLetters;
+    vector<int> scratchMinErrors;
+
+    hashmap<uint64_t, LevenshteinAutomaton::State> transitions;
+
+    vector<int> next;
+    vector<int> substituteErrors;
+    size_t cellsComputed; // Rows evaluated so far times their length.
+
+    LevenshteinAutomatonPrivate(const Word &q, const ErrorValues &e_) : query(q), e(e_) {}
+
+    const int* row(const LevenshteinAutomaton::State s) const {
+        if(s & SCRATCH_STATE)
+            return &scratch[(s & ~SCRATCH_STATE)*stride];
+        return &states[s*stride];
+    }
+
+    Letter letter(const LevenshteinAutomaton::State s) const {
+        if(s & SCRATCH_STATE)
+            return scratchLetters[s & ~SCRATCH_STATE];
+        return stateLetters[s];
+    }
+
+    int minError(const LevenshteinAutomaton::State s) const {
+        if(s & SCRATCH_STATE)
+            return scratchMinErrors[s & ~SCRATCH_STATE];
+        return minErrors[s];
+    }
+
+    size_t hashState(const int *r, const Letter l) const {
+        size_t h = (size_t)l;
+        for(size_t i=0; i<stride; i++)
+            h = h*1000003 ^ (size_t)r[i];
+        return h;
+    }
+
+    void growLookup();
+    LevenshteinAutomaton::State intern(const int *r, const Letter l, const size_t depth);
+};
+
+void LevenshteinAutomatonPrivate::growLookup() {
+    vector<LevenshteinAutomaton::State> newLookup(lookup.empty() ? 64 : 2*lookup.size(), NO_STATE);
+    const size_t mask = newLookup.size() - 1;
+    for(LevenshteinAutomaton::State s=0; s<stateLetters.size(); s++) {
+        size_t slot = hashState(row(s), stateLetters[s]) & mask;
+        while(newLookup[slot] != NO_STATE)
+            slot = (slot + 1) & mask;
+        newLookup[slot] = s;
+    }
+    lookup.swap(newLookup);
+}
+
+LevenshteinAutomaton::State LevenshteinAutomatonPrivate::intern(const int *r, const Letter l, const size_t depth) {
+    int minValue = *min_element(r, r + letters.size() + 1);
+    if(2*(stateLetters.size()+1) > lookup.size())
+        growLookup();
+    const size_t mask = lookup.size() - 1;
+    size_t slot = hashState(r, l) & mask;
+    while(lookup[slot] != NO_STATE) {
+        const LevenshteinAutomaton::State s = lookup[slot];
+        if(stateLetters[s] == l && equal(r, r + stride, row(s)))
+            return s;
+        slot = (slot + 1) & mask;
+    }
+    if(stateLetters.size() < maxStates) {
+        const LevenshteinAutomaton::State s = stateLetters.size();
+        states.insert(states.end(), r, r + stride);
+        stateLetters.push_back(l);
+        minErrors.push_back(minValue);
+        lookup[slot] = s;
+        return s;
+    }
+    if(scratchLetters.size() <= depth) {
+        scratch.resize((depth+1)*stride);
+        scratchLetters.resize(depth+1);
+        scratchMinErrors.resize(depth+1);
+    }
+    copy(r, r + stride, scratch.begin() + depth*stride);
+    scratchLetters[depth] = l;
+    scratchMinErrors[depth] = minValue;
+    return SCRATCH_STATE | depth;
+}
+
+LevenshteinAutomaton::LevenshteinAutomaton(const Word &query, const ErrorValues &e, const int maxError,
+        const size_t maxStates) {
+    const size_t length = query.length();
+    if(maxStates == 0) {
+        throw invalid_argument("Levenshtein automaton must be able to hold at least one state.");
+    }
+    p = new LevenshteinAutomatonPrivate(query, e);
+    for(size_t i=0; i<length; i++)
+        p->letters.push_back(query[i]);
+    p->maxError = maxError;
+    p->clampError = maxError < 0 ? 0 : maxError + 1;
+    p->startInsertionError = e.getStartInsertionError(length);
+    p->uniformError = e.hasUniformErrors(length) ? e.getInsertionError() : 0;
+    p->maxStates = maxStates;
+    p->cellsComputed = 0;
+    p->stride = 2*(length+1);
+    p->next.resize(p->stride);
+    p->substituteErrors.resize(length);
+
+    // Same as the first row of LevenshteinIndex's error matrix.
+    for(size_t i=0; i<=length; i++) {
+        p->next[i] = min((int)i*e.getDeletionError(), p->clampError);
+        p->next[length+1+i] = p->clampError;
+    }
+    p->intern(p->next.data(), 0, 0);
+}
+
+LevenshteinAutomaton::~LevenshteinAutomaton() {
+    delete p;
+}
+
+const Word& LevenshteinAutomaton::getQuery() const {
+    return p->query;
+}
+
+int LevenshteinAutomaton::getMaxError() const {
+    return p->maxError;
+}
+
+size_t LevenshteinAutomaton::numStates() const {
+    return p->stateLetters.size();
+}
+
+size_t LevenshteinAutomaton::cellsComputed() const {
+    return p->cellsComputed;
+}
+
+int LevenshteinAutomaton::getUniformError() const {
+    return p->uniformError;
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::startState() const {
+    return 0;
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::step(const State from, const Letter letter, const size_t depth) {
+    const uint64_t key = ((uint64_t)from) << 32 | (uint64_t)letter;
+    if(!(from & SCRATCH_STATE)) {
+        auto t = p->transitions.find(key);
+        if(t != p->transitions.end())
+            return t->second;
+    }
+    const size_t length = p->letters.size();
+    const int *previous = p->row(from);
+    int *next = p->next.data();
+    ErrorRowInput in;
+
+    p->e.getSubstituteErrors(letter, p->letters.data(), length, p->substituteErrors.data());
+    in.previous = previous;
+    in.beforePrevious = previous + length + 1;
+    in.substituteErrors = p->substituteErrors.data();
+    in.query = p->letters.data();
+    in.queryLength = length;
+    in.letter = letter;
+    in.previousLetter = p->letter(from);
+    in.insertionError = p->e.getInsertionError();
+    in.deletionError = p->e.getDeletionError();
+    in.endDeletionError = p->e.getEndDeletionError();
+    in.transposeError = p->e.getTransposeError();
+    next[0] = previous[0] + p->startInsertionError;
+    evaluateErrorRow(in, next);
+    p->cellsComputed += length + 1;
+    for(size_t i=0; i<=length; i++)
+        next[i] = min(next[i], p->clampError);
+
+    // Cells of this row that a transposition on the next letter can use.
+    Letter transposeLetter = 0;
+    for(size_t i=0; i<=length; i++) {
+        if(i+1 < length && p->letters[i+1] == letter && previous[i] < p->clampError) {
+            next[length+1+i] = previous[i];
+            transposeLetter = letter;
+        } else {
+            next[length+1+i] = p->clampError;
+        }
+    }
+
+    const State to = p->intern(next, transposeLetter, depth);
+    if(!(from & SCRATCH_STATE) && !(to & SCRATCH_STATE))
+        p->transitions[key] = to;
+    return to;
+}
+
+int LevenshteinAutomaton::totalError(const State s) const {
+    return p->row(s)[p->letters.size()];
+}
+
+bool LevenshteinAutomaton::isDead(const State s) const {
+    return p->minError(s) > p->maxError;
+}
+
+COL_NAMESPACE_END
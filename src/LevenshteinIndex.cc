@@ -23,17 +23,38 @@
  * here:
  *
  * http://stevehanov.ca/blog/index.php?id=114
+ *
+ * When all edit operations cost the same, the error rows are instead
+ * evaluated with the bit-parallel algorithm of Myers as extended to
+ * transpositions by Hyyrö:
+ *
+ * H. Hyyrö, "A bit-vector algorithm for computing Levenshtein and
+ * Damerau edit distances", Nordic Journal of Computing 10 (2003).
+ *
+ * A row of up to 64 query letters is then updated with a dozen word
+ * operations instead of four matrix lookups per letter.
  */
 
 #include <stdio.h>
 #include <cassert>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include "LevenshteinIndex.hh"
 #include "ErrorValues.hh"
 #include "Word.hh"
 #include "ErrorMatrix.hh"
+#include "RowKernel.hh"
+#include "LevenshteinAutomaton.hh"
+#include "IncrementalSearch.hh"
 #include "Trie.hh"
+#include "Dawg.hh"
+#include "WordGraph.hh"
+#include "SnapshotFile.hh"
+#include "ContainerMemory.hh"
 
 #ifdef HAS_SPARSE_HASH
 #include <google/sparse_hash_map>
@@ -53,14 +74,149 @@ typedef ChildList::const_iterator ChildListConstIter;
 
 typedef hashmap<WordID, size_t> WordCount;
 
+static const size_t BIT_PARALLEL_MAX_LENGTH = 64;
+static const size_t ASCII_LETTERS = 128;
+
+/*
+ * For every letter a bit mask of the query positions it appears in.
+ */
+struct BitParallelQuery {
+    uint64_t asciiMasks[ASCII_LETTERS];
+    vector<pair<Letter, uint64_t> > otherMasks;
+    uint64_t lastBit;
+    size_t length;
+    int unitError;
+
+    uint64_t matchMask(const Letter l) const {
+        if(l < ASCII_LETTERS)
+            return asciiMasks[l];
+        for(const auto &i : otherMasks) {
+            if(i.first == l)
+                return i.second;
+        }
+        return 0;
+    }
+};
+
+/*
+ * One row of the error matrix in delta encoding. Bit i of vp (vn) is set
+ * if the error in query position i+1 is one more (less) than in position i.
+ * The diagonal zero vector and the letter's match mask are needed when
+ * evaluating transpositions on the next row.
+ */
+struct BitParallelRow {
+    uint64_t vp;
+    uint64_t vn;
+    uint64_t d0;
+    uint64_t eq;
+    int score; // Error at the last query letter in units.
+};
+
+static void buildBitParallelQuery(const Word &query, const int unitError, BitParallelQuery &q) {
+    for(size_t i=0; i<ASCII_LETTERS; i++)
+        q.asciiMasks[i] = 0;
+    for(size_t i=0; i<query.length(); i++) {
+        const Letter l = query[i];
+        const uint64_t bit = ((uint64_t)1) << i;
+        if(l < ASCII_LETTERS) {
+            q.asciiMasks[l] |= bit;
+            continue;
+        }
+        bool found = false;
+        for(auto &j : q.otherMasks) {
+            if(j.first == l) {
+                j.second |= bit;
+                found = true;
+            }
+        }
+        if(!found)
+            q.otherMasks.push_back(make_pair(l, bit));
+    }
+    q.lastBit = ((uint64_t)1) << (query.length()-1);
+    q.length = query.length();
+    q.unitError = unitError;
+}
+
+static void advanceRow(const BitParallelQuery &q, const BitParallelRow &previous, const Letter letter,
+        BitParallelRow &row) {
+    const uint64_t eq = q.matchMask(letter);
+    const uint64_t vp = previous.vp;
+    const uint64_t vn = previous.vn;
+    const uint64_t transpose = (((~previous.d0) & eq) << 1) & previous.eq;
+    const uint64_t d0 = (((eq & vp) + vp) ^ vp) | eq | vn | transpose;
+    const uint64_t hp = vn | ~(d0 | vp);
+    const uint64_t hn = vp & d0;
+    const uint64_t x = (hp << 1) | 1; // Column zero grows by one on every row.
+    row.score = previous.score;
+    if(hp & q.lastBit)
+        row.score++;
+    if(hn & q.lastBit)
+        row.score--;
+    row.vn = x & d0;
+    row.vp = (hn << 1) | ~(x | d0);
+    row.d0 = d0;
+    row.eq = eq;
+}
+
+/*
+ * Whether any query position on this row is within the error limit.
+ * Column zero has the value depth and the rest follow from the deltas.
+ */
+static bool rowWithinLimit(const BitParallelQuery &q, const BitParallelRow &row, const size_t depth,
+        const int maxUnits) {
+    int current = (int)depth;
+    if(current <= maxUnits || row.score <= maxUnits)
+        return true;
+    for(size_t i=0; i<q.length; i++) {
+        const uint64_t bit = ((uint64_t)1) << i;
+        if(row.vp & bit)
+            current++;
+        else if(row.vn & bit) {
+            current--;
+            if(current <= maxUnits)
+                return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+ * The most common words below a trie node, most common first. Ties go
+ * to the smaller WordID.
+ */
+struct CompletionList {
+    WordID words[LevenshteinIndex::COMPLETIONS_PER_PREFIX];
+    size_t size;
+};
+
+typedef hashmap<GraphOffset, CompletionList> CompletionMap;
+
+struct CompletionCandidates {
+    const CompletionMap *lists;
+    hashmap<WordID, int> errors; // Best error of every word found so far.
+    size_t nodesVisited;
+    size_t cellsComputed;
+
+    explicit CompletionCandidates(const CompletionMap *lists_) : lists(lists_), nodesVisited(0), cellsComputed(0) {}
+};
 
 struct LevenshteinIndexPrivate {
     WordCount wordCounts; // How many times the word has been added to this index.
+    /*
+     * Built by the first prefix search and thrown away whenever the index
+     * changes, so indexes that are never prefix searched do not pay for
+     * them. Searches run concurrently, hence the lock.
+     */
+    unique_ptr<CompletionMap> completions;
+    mutex completionLock;
     size_t maxCount; // How many times the most common word has been added.
     size_t numNodes;
     size_t numWords; // How many words are in this index in total.
     size_t longestWordLength; // Longest word that has been added. Same as tree depth.
-    Trie trie;
+    unique_ptr<Trie> trie; // Null when the words are in the word graph.
+    Dawg dawg;
+    WordGraph graph; // What the searches walk.
 };
 
 
@@ -68,6 +224,8 @@ LevenshteinIndex::LevenshteinIndex() {
     p = new LevenshteinIndexPrivate();
     p->maxCount = 0;
     p->longestWordLength = 0;
+    p->trie.reset(new Trie());
+    p->graph.setTrie(p->trie.get());
 }
 
 LevenshteinIndex::~LevenshteinIndex() {
@@ -88,8 +246,11 @@ void LevenshteinIndex::insertWord(const Word &word, const WordID wordID) {
     } else {
         newCount = 1;
     }
-    p->trie.insertWord(word, wordID);
+    if(!p->trie)
+        expandGraph();
+    p->trie->insertWord(word, wordID);
     p->wordCounts[wordID] = newCount;
+    p->completions.reset();
     if(word.length() > p->longestWordLength)
         p->longestWordLength = word.length();
     if(p->maxCount < newCount)
@@ -97,71 +258,301 @@ void LevenshteinIndex::insertWord(const Word &word, const WordID wordID) {
     return;
 }
 
+static bool moreCommon(const WordCount &counts, const WordID w1, const WordID w2) {
+    const size_t c1 = counts.find(w1)->second;
+    const size_t c2 = counts.find(w2)->second;
+    if(c1 != c2)
+        return c1 > c2;
+    return w1 < w2;
+}
+
+/*
+ * Adds a word to a completion list or moves it up after its count grew.
+ * Returns false if the word did not make it to the list.
+ */
+static bool addCompletion(const WordCount &counts, CompletionList &list, const WordID wordID) {
+    size_t i = 0;
+    while(i < list.size && list.words[i] != wordID)
+        i++;
+    if(i == list.size) {
+        if(list.size < LevenshteinIndex::COMPLETIONS_PER_PREFIX) {
+            list.size++;
+        } else if(moreCommon(counts, wordID, list.words[list.size-1])) {
+            i = list.size-1;
+        } else {
+            return false;
+        }
+    }
+    while(i > 0 && moreCommon(counts, wordID, list.words[i-1])) {
+        list.words[i] = list.words[i-1];
+        i--;
+    }
+    list.words[i] = wordID;
+    return true;
+}
+
+static void buildCompletions(const LevenshteinIndexPrivate *p, GraphOffset node, CompletionMap &completions) {
+    CompletionList list;
+    list.size = 0;
+    const WordID wordID = p->graph.getWordID(node);
+    if(wordID != INVALID_WORDID)
+        addCompletion(p->wordCounts, list, wordID);
+    GraphOffset sibling = p->graph.getSiblingList(node);
+    while(sibling != 0) {
+        const GraphOffset child = p->graph.getChild(sibling);
+        buildCompletions(p, child, completions);
+        const CompletionList &childList = completions.find(child)->second;
+        for(size_t i=0; i<childList.size; i++) {
+            if(!addCompletion(p->wordCounts, list, childList.words[i]))
+                break;
+        }
+        sibling = p->graph.getNextSibling(sibling);
+    }
+    completions[node] = list;
+}
+
+static const CompletionMap* completionLists(LevenshteinIndexPrivate *p) {
+    lock_guard<mutex> lock(p->completionLock);
+    if(!p->completions) {
+        unique_ptr<CompletionMap> completions(new CompletionMap());
+        buildCompletions(p, p->graph.getRoot(), *completions);
+        p->completions = std::move(completions);
+    }
+    return p->completions.get();
+}
+
 bool LevenshteinIndex::hasWord(const Word &word) const {
-    return p->trie.hasWord(word);
+    if(!p->trie) {
+        const GraphOffset node = p->dawg.findWord(word);
+        return node != 0 && p->dawg.getWordID(node) != INVALID_WORDID;
+    }
+    return p->trie->hasWord(word);
 }
 
 void LevenshteinIndex::findWords(const Word &query, const ErrorValues &e, const int maxError, IndexMatches &matches) const {
-    TrieOffset root;
-    TrieOffset sibling;
+    GraphOffset root;
+    GraphOffset sibling;
+    if(query.length() > 0 && query.length() <= BIT_PARALLEL_MAX_LENGTH &&
+            e.hasUniformErrors(query.length()) && e.getInsertionError() > 0) {
+        findWordsBitParallel(query, e.getInsertionError(), maxError, matches);
+        matches.sort();
+        return;
+    }
     ErrorMatrix em(p->longestWordLength+1, query.length()+1,
             e.getDeletionError(), e.getStartInsertionError(query.length()));
 
     assert(em.get(0, 0) == 0);
     if(query.length() > 0)
         assert(em.get(0, 1) == e.getInsertionError());
-    root = p->trie.getRoot();
-    sibling = p->trie.getSiblingList(root);
+    vector<int> substituteErrors(query.length());
+    root = p->graph.getRoot();
+    sibling = p->graph.getSiblingList(root);
     while(sibling != 0) {
-        Letter l = p->trie.getLetter(sibling);
-        TrieOffset nextNode = p->trie.getChild(sibling);
-        searchRecursive(query, nextNode, e, l, (Letter)0, 1, em, matches, maxError);
-        sibling = p->trie.getNextSibling(sibling);
+        Letter l = p->graph.getLetter(sibling);
+        GraphOffset nextNode = p->graph.getChild(sibling);
+        searchRecursive(query, nextNode, e, l, (Letter)0, 1, em, substituteErrors.data(), matches, maxError);
+        sibling = p->graph.getNextSibling(sibling);
     }
     matches.sort();
 }
 
-int LevenshteinIndex::findOptimalError(const Letter letter, const Letter previousLetter, const Word &query,
-        const size_t i, const size_t depth, const ErrorMatrix &em, const ErrorValues &e) const {
-    int insertError = em.get(depth, i-1) + e.getInsertionError();
-    int deleteError;
-    if(i >= query.length())
-        deleteError = em.get(depth-1, i) + e.getEndDeletionError();
-    else
-        deleteError = em.get(depth-1, i) + e.getDeletionError();
+void LevenshteinIndex::searchRecursive(const Word &query, GraphOffset node, const ErrorValues &e,
+        const Letter letter, const Letter previousLetter, const size_t depth, ErrorMatrix &em,
+        int *substituteErrors, IndexMatches &matches, const int maxError) const {
+    ErrorRowInput row;
 
-    int substituteError = em.get(depth-1, i-1) + e.getSubstituteError(query.text[i-1], letter);
+    e.getSubstituteErrors(letter, query.text, query.length(), substituteErrors);
+    row.previous = em.getRow(depth-1);
+    row.beforePrevious = depth > 1 ? em.getRow(depth-2) : nullptr;
+    row.substituteErrors = substituteErrors;
+    row.query = query.text;
+    row.queryLength = query.length();
+    row.letter = letter;
+    row.previousLetter = previousLetter;
+    row.insertionError = e.getInsertionError();
+    row.deletionError = e.getDeletionError();
+    row.endDeletionError = e.getEndDeletionError();
+    row.transposeError = e.getTransposeError();
+    evaluateErrorRow(row, em.getRow(depth));
+    matches.addWork(1, query.length() + 1);
 
-    int transposeError;
-    if(i > 1 && query.text[i - 1] == previousLetter && query.text[i - 2] == letter) {
-        transposeError = em.get(depth-2, i-2) + e.getTransposeError();
-    } else {
-        transposeError = insertError + 10000; // Ensures this will not be chosen.
+    // Error row evaluated. Now check if a word was found and continue recursively.
+    if(em.totalError(depth) <= maxError && p->graph.getWordID(node) != INVALID_WORDID) {
+        matches.addMatch(query, p->graph.getWordID(node), em.totalError(depth));
+    }
+    if(em.minError(depth) <= maxError) {
+        GraphOffset sibling = p->graph.getSiblingList(node);
+        while(sibling != 0) {
+            Letter l = p->graph.getLetter(sibling);
+            GraphOffset nextNode = p->graph.getChild(sibling);
+            searchRecursive(query, nextNode, e, l, letter, depth+1, em, substituteErrors, matches, maxError);
+            sibling = p->graph.getNextSibling(sibling);
+        }
     }
-    return min(insertError, min(deleteError, min(substituteError, transposeError)));
 }
 
-void LevenshteinIndex::searchRecursive(const Word &query, TrieOffset node, const ErrorValues &e,
-        const Letter letter, const Letter previousLetter, const size_t depth, ErrorMatrix &em,
-        IndexMatches &matches, const int maxError) const {
+void LevenshteinIndex::findWordsBitParallel(const Word &query, const int unitError, const int maxError,
+        IndexMatches &matches) const {
+    BitParallelQuery q;
+    BitParallelRow root;
+    if(maxError < 0)
+        return;
+    buildBitParallelQuery(query, unitError, q);
+    root.vp = ~((uint64_t)0);
+    root.vn = 0;
+    root.d0 = ~((uint64_t)0);
+    root.eq = 0;
+    root.score = query.length();
+    const int maxUnits = maxError / unitError;
+    GraphOffset sibling = p->graph.getSiblingList(p->graph.getRoot());
+    while(sibling != 0) {
+        searchBitParallel(q, p->graph.getChild(sibling), root, p->graph.getLetter(sibling), 1, matches, maxUnits);
+        sibling = p->graph.getNextSibling(sibling);
+    }
+}
 
-    for(size_t i = 1; i < query.length()+1; i++) {
-        int minError = findOptimalError(letter, previousLetter, query, i, depth, em, e);
-        em.set(depth, i, minError);
+void LevenshteinIndex::searchBitParallel(const BitParallelQuery &q, GraphOffset node, const BitParallelRow &previous,
+        const Letter letter, const size_t depth, IndexMatches &matches, const int maxUnits) const {
+    BitParallelRow row;
+    advanceRow(q, previous, letter, row);
+    matches.addWork(1, q.length + 1);
+    const WordID wordID = p->graph.getWordID(node);
+    if(row.score <= maxUnits && wordID != INVALID_WORDID) {
+        matches.addMatch(Word(), wordID, row.score*q.unitError);
     }
+    if(!rowWithinLimit(q, row, depth, maxUnits))
+        return;
+    GraphOffset sibling = p->graph.getSiblingList(node);
+    while(sibling != 0) {
+        searchBitParallel(q, p->graph.getChild(sibling), row, p->graph.getLetter(sibling), depth+1, matches, maxUnits);
+        sibling = p->graph.getNextSibling(sibling);
+    }
+}
 
-    // Error row evaluated. Now check if a word was found and continue recursively.
-    if(em.totalError(depth) <= maxError && p->trie.getWordID(node) != INVALID_WORDID) {
-        matches.addMatch(query, p->trie.getWordID(node), em.totalError(depth));
+/*
+ * Gives the same results as findWords with the automaton's query, but
+ * reuses the rows already computed for earlier nodes and searches.
+ */
+void LevenshteinIndex::findWords(LevenshteinAutomaton &a, IndexMatches &matches) const {
+    const Word &query = a.getQuery();
+    if(query.length() > 0 && query.length() <= BIT_PARALLEL_MAX_LENGTH && a.getUniformError() > 0) {
+        findWordsBitParallel(query, a.getUniformError(), a.getMaxError(), matches);
+        matches.sort();
+        return;
     }
-    if(em.minError(depth) <= maxError) {
-        TrieOffset sibling = p->trie.getSiblingList(node);
-        while(sibling != 0) {
-            Letter l = p->trie.getLetter(sibling);
-            TrieOffset nextNode = p->trie.getChild(sibling);
-            searchRecursive(query, nextNode, e, l, letter, depth+1, em, matches, maxError);
-            sibling = p->trie.getNextSibling(sibling);
-        }
+    const size_t cellsBefore = a.cellsComputed();
+    GraphOffset sibling = p->graph.getSiblingList(p->graph.getRoot());
+    while(sibling != 0) {
+        searchAutomaton(a, p->graph.getChild(sibling), a.startState(), p->graph.getLetter(sibling), 1, matches);
+        sibling = p->graph.getNextSibling(sibling);
+    }
+    // Rows the automaton already had are not computed again.
+    matches.addWork(0, a.cellsComputed() - cellsBefore);
+    matches.sort();
+}
+
+void LevenshteinIndex::searchAutomaton(LevenshteinAutomaton &a, GraphOffset node, const uint32_t previousState,
+        const Letter letter, const size_t depth, IndexMatches &matches) const {
+    const LevenshteinAutomaton::State state = a.step(previousState, letter, depth);
+    matches.addWork(1, 0);
+    const WordID wordID = p->graph.getWordID(node);
+    if(a.totalError(state) <= a.getMaxError() && wordID != INVALID_WORDID) {
+        matches.addMatch(a.getQuery(), wordID, a.totalError(state));
+    }
+    if(a.isDead(state))
+        return;
+    GraphOffset sibling = p->graph.getSiblingList(node);
+    while(sibling != 0) {
+        searchAutomaton(a, p->graph.getChild(sibling), state, p->graph.getLetter(sibling), depth+1, matches);
+        sibling = p->graph.getNextSibling(sibling);
+    }
+}
+
+/*
+ * Gives the same results as findWords with the same query, but picks up
+ * where the previous search with s left off if query extends its query.
+ */
+void LevenshteinIndex::findWords(IncrementalSearch &s, const Word &query, const int maxError, IndexMatches &matches) const {
+    s.search(p->graph, this, query, maxError, matches);
+    matches.sort();
+}
+
+void LevenshteinIndex::findCompletions(const Word &query, const ErrorValues &e, const int maxError, IndexMatches &matches) const {
+    CompletionCandidates candidates(completionLists(p));
+    ErrorMatrix em(p->longestWordLength+1, query.length()+1,
+            e.getDeletionError(), e.getStartInsertionError(query.length()));
+    vector<int> substituteErrors(query.length());
+    GraphOffset sibling = p->graph.getSiblingList(p->graph.getRoot());
+    while(sibling != 0) {
+        searchCompletions(query, p->graph.getChild(sibling), e, p->graph.getLetter(sibling), (Letter)0, 1, em,
+                substituteErrors.data(), candidates, maxError);
+        sibling = p->graph.getNextSibling(sibling);
+    }
+    vector<pair<int, WordID> > found;
+    for(const auto &i : candidates.errors)
+        found.push_back(make_pair(i.second, i.first));
+    const WordCount &counts = p->wordCounts;
+    sort(found.begin(), found.end(), [&counts](const pair<int, WordID> &a, const pair<int, WordID> &b) -> bool {
+        if(a.first != b.first)
+            return a.first < b.first;
+        return moreCommon(counts, a.second, b.second);
+    });
+    for(const auto &i : found)
+        matches.addMatch(query, i.second, i.first);
+    matches.addWork(candidates.nodesVisited, candidates.cellsComputed);
+    matches.sort();
+}
+
+static void addCandidate(CompletionCandidates &candidates, const WordID wordID, const int error) {
+    auto it = candidates.errors.find(wordID);
+    if(it == candidates.errors.end())
+        candidates.errors[wordID] = error;
+    else if(error < it->second)
+        it->second = error;
+}
+
+void LevenshteinIndex::searchCompletions(const Word &query, GraphOffset node, const ErrorValues &e,
+        const Letter letter, const Letter previousLetter, const size_t depth, ErrorMatrix &em,
+        int *substituteErrors, CompletionCandidates &candidates, const int maxError) const {
+    ErrorRowInput row;
+
+    e.getSubstituteErrors(letter, query.text, query.length(), substituteErrors);
+    row.previous = em.getRow(depth-1);
+    row.beforePrevious = depth > 1 ? em.getRow(depth-2) : nullptr;
+    row.substituteErrors = substituteErrors;
+    row.query = query.text;
+    row.queryLength = query.length();
+    row.letter = letter;
+    row.previousLetter = previousLetter;
+    row.insertionError = e.getInsertionError();
+    row.deletionError = e.getDeletionError();
+    row.endDeletionError = e.getEndDeletionError();
+    row.transposeError = e.getTransposeError();
+    evaluateErrorRow(row, em.getRow(depth));
+    candidates.nodesVisited++;
+    candidates.cellsComputed += query.length() + 1;
+
+    const int error = em.totalError(depth);
+    const int rowMin = em.minError(depth);
+    if(error <= maxError) {
+        const WordID wordID = p->graph.getWordID(node);
+        if(wordID != INVALID_WORDID)
+            addCandidate(candidates, wordID, error);
+        const CompletionList &list = candidates.lists->find(node)->second;
+        for(size_t i=0; i<list.size; i++)
+            addCandidate(candidates, list.words[i], error);
+        // Every error below this node is at least the smallest one on this
+        // row or, through a transposition, the row before it.
+        if(error <= min(rowMin, em.minError(depth-1)))
+            return;
+    }
+    if(rowMin > maxError)
+        return;
+    GraphOffset sibling = p->graph.getSiblingList(node);
+    while(sibling != 0) {
+        searchCompletions(query, p->graph.getChild(sibling), e, p->graph.getLetter(sibling), letter, depth+1, em,
+                substituteErrors, candidates, maxError);
+        sibling = p->graph.getNextSibling(sibling);
     }
 }
 
@@ -177,11 +568,122 @@ size_t LevenshteinIndex::maxCount() const {
 }
 
 size_t LevenshteinIndex::numNodes() const {
-    return p->trie.numNodes();
+    return p->trie ? p->trie->numNodes() : p->dawg.numNodes();
 }
 
 size_t LevenshteinIndex::numWords() const {
-    return p->trie.numWords();
+    return p->trie ? p->trie->numWords() : p->dawg.numWords();
+}
+
+size_t LevenshteinIndex::memoryUsage() const {
+    size_t graphMemory = p->trie ? p->trie->memoryUsage() : p->dawg.memoryUsage();
+    lock_guard<mutex> lock(p->completionLock);
+    const size_t completionMemory = p->completions ? hashMemory(*p->completions) : 0;
+    return graphMemory + hashMemory(p->wordCounts) + completionMemory;
+}
+
+void LevenshteinIndex::freeze() {
+    if(!p->trie || p->trie->isFrozen())
+        return;
+    p->trie->freeze();
+    // The completion lists are keyed by node offsets, which all changed.
+    p->completions.reset();
+}
+
+void LevenshteinIndex::compact() {
+    if(!p->trie || p->trie->isSuccinct())
+        return;
+    p->trie->makeSuccinct();
+    p->completions.reset();
+}
+
+void LevenshteinIndex::minimize() {
+    if(!p->trie)
+        return;
+    p->dawg.build(*p->trie);
+    p->graph.setDawg(&p->dawg);
+    p->trie.reset();
+    p->completions.reset();
+}
+
+bool LevenshteinIndex::isMinimized() const {
+    return !p->trie;
+}
+
+/*
+ * Word graphs can not be added to, so the words go back to a trie.
+ */
+void LevenshteinIndex::expandGraph() {
+    unique_ptr<Trie> trie(new Trie());
+    p->dawg.copyTo(*trie);
+    trie->freeze();
+    p->trie = std::move(trie);
+    p->graph.setTrie(p->trie.get());
+    p->dawg.clear();
+    p->completions.reset();
+}
+
+/*
+ * The trie is written to basename.trie and mapped back in directly when
+ * loading. A word graph goes to basename.dawg instead and is read in.
+ * Word counts go to basename.counts as two parallel arrays.
+ */
+void LevenshteinIndex::save(const std::string &basename) const {
+    vector<WordID> ids;
+    vector<uint64_t> counts;
+    ids.reserve(p->wordCounts.size());
+    counts.reserve(p->wordCounts.size());
+    for(const auto &i : p->wordCounts) {
+        ids.push_back(i.first);
+        counts.push_back(i.second);
+    }
+    if(p->trie) {
+        p->trie->save((basename + ".trie").c_str());
+    } else {
+        SnapshotWriter graphOut(basename + ".dawg", "dawg");
+        p->dawg.save(graphOut);
+        graphOut.finish();
+    }
+    SnapshotWriter out(basename + ".counts", "levindex");
+    out.writeValue(p->trie ? 0 : 1);
+    out.writeValue(p->maxCount);
+    out.writeValue(p->longestWordLength);
+    out.writeArray(ids.data(), ids.size());
+    out.writeArray(counts.data(), counts.size());
+    out.finish();
+}
+
+void LevenshteinIndex::load(const std::string &basename) {
+    SnapshotReader in(basename + ".counts", "levindex");
+    size_t numIDs, numCounts;
+    WordCount newCounts;
+    const bool minimized = in.readValue() != 0;
+    size_t newMaxCount = in.readValue();
+    size_t newLongest = in.readValue();
+    const WordID *ids = in.readArray<WordID>(numIDs);
+    const uint64_t *counts = in.readArray<uint64_t>(numCounts);
+    if(numIDs != numCounts) {
+        throw runtime_error("Corrupt word count file " + basename + ".counts");
+    }
+    for(size_t i=0; i<numIDs; i++) {
+        newCounts[ids[i]] = counts[i];
+    }
+    if(minimized) {
+        SnapshotReader graphIn(basename + ".dawg", "dawg");
+        p->dawg.load(graphIn);
+        p->graph.setDawg(&p->dawg);
+        p->trie.reset();
+    } else {
+        unique_ptr<Trie> newTrie(new Trie());
+        newTrie->openReadOnly((basename + ".trie").c_str());
+        p->trie = std::move(newTrie);
+        p->graph.setTrie(p->trie.get());
+        p->dawg.clear();
+    }
+    p->wordCounts.swap(newCounts);
+    p->maxCount = newMaxCount;
+    p->longestWordLength = newLongest;
+    p->completions.reset();
 }
 
 COL_NAMESPACE_END
@@ -20,6 +20,7 @@
 #include "Matcher.hh"
 #include "Corpus.hh"
 #include "LevenshteinIndex.hh"
+#include "LevenshteinAutomaton.hh"
 #include "Word.hh"
 #include "Document.hh"
 #include "WordList.hh"
@@ -32,12 +33,29 @@
 #include "WordStore.hh"
 #include "ResultFilter.hh"
 #include "SearchParameters.hh"
+#include "SnapshotFile.hh"
+#include "ThreadPool.hh"
+#include "PostingList.hh"
+#include "IncrementalSearch.hh"
+#include "QuerySession.hh"
+#include "QueryStats.hh"
+#include "MemoryUsage.hh"
+#include "ContainerMemory.hh"
+#include "Tokenizer.hh"
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
 #include <cassert>
 #include <stdexcept>
 #include <map>
 #include <set>
+#include <list>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <atomic>
 
 #ifdef HAS_SPARSE_HASH
 #include <google/sparse_hash_map>
@@ -56,24 +74,12 @@ using google::sparse_hash_set;
 COL_NAMESPACE_START
 using namespace std;
 
-struct idhasher : std::unary_function<const pair<WordID, WordID>, size_t> {
-    size_t operator() ( const pair<WordID, WordID> &p) const {
-        size_t w1 = p.first;
-        size_t w2 = p.second;
-        if(sizeof(size_t) > sizeof(WordID)) {
-            return (w1 << 32) | w2; // Assuming size_t is 64 bits.
-        } else {
-            return w1 ^ w2;
-        }
-    }
-};
-
-typedef hashset<DocumentID> DocumentSet;
+typedef DocumentID DocumentOrdinal;
 typedef hashmap<WordID, LevenshteinIndex*> IndexMap;
-typedef hashmap<std::pair<WordID, WordID>, DocumentSet, idhasher > ReverseIndexData; // Index name, word, documents.
+typedef hashmap<WordID, PostingList> FieldPostings; // Word, document ordinals.
+typedef hashmap<WordID, FieldPostings> ReverseIndexData; // Index name, postings.
 
 typedef IndexMap::iterator IndIterator;
-typedef ReverseIndexData::iterator RevIndIterator;
 
 typedef map<WordID, int> MatchErrorMap;
 
@@ -83,16 +89,43 @@ typedef BestIndexMatches::iterator MatchIndIterator;
 typedef MatchErrorMap::iterator MatchIterator;
 
 
+/*
+ * The reverse index is sharded by field. Once a field has been added,
+ * its postings can be updated concurrently with other fields. A field
+ * must be finalized after adding documents to it before it is queried.
+ *
+ * Postings hold document ordinals: dense numbers given to documents in
+ * the order they are first indexed. They keep the posting lists compact
+ * and let queries score documents in a flat array.
+ */
 class ReverseIndex {
 private:
     ReverseIndexData reverseIndex;
+    hashmap<DocumentID, DocumentOrdinal> ordinals;
+    vector<DocumentID> documents; // Indexed by ordinal.
 public:
 
-    void add(const WordID wordID, const WordID indexID, const DocumentID id);
-    bool documentHasTerm(const WordID wordID, const WordID indexID, DocumentID id);
-    void findDocuments(const WordID wordID, const WordID indexID, std::vector<DocumentID> &result);
+    DocumentOrdinal addDocument(const DocumentID id);
+    bool findOrdinal(const DocumentID id, DocumentOrdinal &ordinal) const;
+    DocumentID documentID(const DocumentOrdinal ordinal) const { return documents[ordinal]; }
+    size_t numDocuments() const { return documents.size(); }
+
+    void addField(const WordID indexID);
+    void add(const WordID wordID, const WordID indexID, const DocumentOrdinal ordinal);
+    void finalizeField(const WordID indexID);
+    const PostingList* postings(const WordID wordID, const WordID indexID) const;
+    bool documentHasTerm(const WordID wordID, const WordID indexID, const DocumentOrdinal ordinal) const;
+    void findDocuments(const WordID wordID, const WordID indexID, std::vector<DocumentID> &result) const;
+
+    size_t fieldMemoryUsage(const WordID indexID) const;
+    size_t documentMemoryUsage() const;
+
+    void save(SnapshotWriter &out) const;
+    void load(SnapshotReader &in);
 };
 
+struct PendingBuild;
+
 struct MatcherPrivate {
     IndexMap indexes;
     ReverseIndex reverseIndex;
@@ -101,44 +134,153 @@ struct MatcherPrivate {
     MatcherStatistics stats;
     WordStore store;
     map<pair<DocumentID, WordID>, size_t> originalSizes; // Lengths of original documents.
+    ThreadPool *pool; // Null when searching in the calling thread only.
+    size_t generation; // Changes whenever query sessions must start over.
+    bool succinctTries;
+    bool minimizedIndexes;
+    PendingBuild *pending; // Text from addText waiting for commit.
 };
 
-void ReverseIndex::add(const WordID wordID, const WordID indexID, const DocumentID id) {
-    pair<WordID, WordID> p;
-    p.first = indexID;
-    p.second = wordID;
-    auto revIt = reverseIndex.find(p);
-    if(revIt == reverseIndex.end()) {
-        DocumentSet tmp;
-        tmp.insert(id);
-        reverseIndex[p] = tmp;
-    } else {
-        revIt->second.insert(id);
-    }
+static atomic<size_t> lastGeneration(0);
+
+/*
+ * Generations are unique across matchers so that a session can not
+ * mistake a new matcher for an old one at the same address.
+ */
+static size_t newGeneration() {
+    return ++lastGeneration;
+}
 
+DocumentOrdinal ReverseIndex::addDocument(const DocumentID id) {
+    auto it = ordinals.find(id);
+    if(it != ordinals.end())
+        return it->second;
+    const DocumentOrdinal ordinal = documents.size();
+    ordinals[id] = ordinal;
+    documents.push_back(id);
+    return ordinal;
 }
 
-bool ReverseIndex::documentHasTerm(const WordID wordID, const WordID indexID, DocumentID id) {
-    pair<WordID, WordID> p;
-    p.first = indexID;
-    p.second = wordID;
-    auto revIt = reverseIndex.find(p);
-    if(revIt == reverseIndex.end())
+bool ReverseIndex::findOrdinal(const DocumentID id, DocumentOrdinal &ordinal) const {
+    auto it = ordinals.find(id);
+    if(it == ordinals.end())
         return false;
-    return revIt->second.find(id) != revIt->second.end();
+    ordinal = it->second;
+    return true;
+}
+
+void ReverseIndex::addField(const WordID indexID) {
+    if(reverseIndex.find(indexID) == reverseIndex.end()) {
+        FieldPostings tmp;
+        reverseIndex[indexID] = tmp;
+    }
+}
+
+void ReverseIndex::add(const WordID wordID, const WordID indexID, const DocumentOrdinal ordinal) {
+    auto fieldIt = reverseIndex.find(indexID);
+    if(fieldIt == reverseIndex.end()) {
+        addField(indexID);
+        fieldIt = reverseIndex.find(indexID);
+    }
+    fieldIt->second[wordID].add(ordinal);
+}
+
+void ReverseIndex::finalizeField(const WordID indexID) {
+    auto fieldIt = reverseIndex.find(indexID);
+    if(fieldIt == reverseIndex.end())
+        return;
+    for(auto &i : fieldIt->second) {
+        i.second.finalize();
+    }
+}
+
+const PostingList* ReverseIndex::postings(const WordID wordID, const WordID indexID) const {
+    auto fieldIt = reverseIndex.find(indexID);
+    if(fieldIt == reverseIndex.end())
+        return nullptr;
+    auto revIt = fieldIt->second.find(wordID);
+    if(revIt == fieldIt->second.end())
+        return nullptr;
+    return &revIt->second;
+}
+
+size_t ReverseIndex::fieldMemoryUsage(const WordID indexID) const {
+    auto fieldIt = reverseIndex.find(indexID);
+    if(fieldIt == reverseIndex.end())
+        return 0;
+    size_t bytes = hashMemory(fieldIt->second);
+    for(const auto &i : fieldIt->second) {
+        // The list itself is counted with the hash node.
+        bytes += i.second.memoryUsage() - sizeof(PostingList);
+    }
+    return bytes;
+}
+
+// Everything except the field shards.
+size_t ReverseIndex::documentMemoryUsage() const {
+    return hashMemory(reverseIndex) + hashMemory(ordinals) + vectorMemory(documents);
+}
+
+bool ReverseIndex::documentHasTerm(const WordID wordID, const WordID indexID, const DocumentOrdinal ordinal) const {
+    const PostingList *docs = postings(wordID, indexID);
+    return docs && docs->contains(ordinal);
 }
 
-void ReverseIndex::findDocuments(const WordID wordID, const WordID indexID, std::vector<DocumentID> &result) {
-    pair<WordID, WordID> p;
-    p.first = indexID;
-    p.second = wordID;
-    auto revIt = reverseIndex.find(p);
-    if(revIt == reverseIndex.end())
+void ReverseIndex::findDocuments(const WordID wordID, const WordID indexID, std::vector<DocumentID> &result) const {
+    const PostingList *docs = postings(wordID, indexID);
+    if(!docs)
         return;
-    DocumentSet &docSet = revIt->second;
-    for(auto docIter = docSet.begin(); docIter != docSet.end(); docIter++) {
-        result.push_back(*docIter);
+    for(PostingList::Iterator it = docs->begin(); !it.atEnd(); it.next()) {
+        result.push_back(documents[it.get()]);
+    }
+}
+
+/*
+ * The reverse index is stored as three flat arrays: the (index, word) keys,
+ * the number of documents for each key and all document IDs back to back.
+ * Ordinals are not saved, they are handed out again when loading.
+ */
+void ReverseIndex::save(SnapshotWriter &out) const {
+    vector<WordID> keys;
+    vector<uint64_t> counts;
+    vector<uint64_t> docs;
+    for(const auto &field : reverseIndex) {
+        for(const auto &i : field.second) {
+            keys.push_back(field.first);
+            keys.push_back(i.first);
+            counts.push_back(i.second.size());
+            for(PostingList::Iterator it = i.second.begin(); !it.atEnd(); it.next()) {
+                docs.push_back(documents[it.get()]);
+            }
+        }
     }
+    out.writeArray(keys.data(), keys.size());
+    out.writeArray(counts.data(), counts.size());
+    out.writeArray(docs.data(), docs.size());
+}
+
+void ReverseIndex::load(SnapshotReader &in) {
+    size_t numKeys, numCounts, numDocs;
+    ReverseIndex newIndex;
+    const WordID *keys = in.readArray<WordID>(numKeys);
+    const uint64_t *counts = in.readArray<uint64_t>(numCounts);
+    const uint64_t *docs = in.readArray<uint64_t>(numDocs);
+    if(numKeys != 2*numCounts) {
+        throw runtime_error("Corrupt reverse index in snapshot.");
+    }
+    size_t docPos = 0;
+    for(size_t i=0; i<numCounts; i++) {
+        if(counts[i] > numDocs - docPos) {
+            throw runtime_error("Corrupt reverse index in snapshot.");
+        }
+        PostingList &docList = newIndex.reverseIndex[keys[2*i]][keys[2*i+1]];
+        for(size_t j=0; j<counts[i]; j++) {
+            docList.add(newIndex.addDocument(docs[docPos + j]));
+        }
+        docList.finalize();
+        docPos += counts[i];
+    }
+    *this = std::move(newIndex);
 }
 
 /*
@@ -146,7 +288,7 @@ void ReverseIndex::findDocuments(const WordID wordID, const WordID indexID, std:
  * with STL includes.
  */
 
-static void addMatches(MatcherPrivate */*p*/, BestIndexMatches &bestIndexMatches, const Word &/*queryWord*/, const WordID indexID, IndexMatches &matches) {
+static void addMatches(const MatcherPrivate */*p*/, BestIndexMatches &bestIndexMatches, const Word &/*queryWord*/, const WordID indexID, IndexMatches &matches) {
     MatchIndIterator it = bestIndexMatches.find(indexID);
     map<WordID, int> *indexMatches;
     if(it == bestIndexMatches.end()) {
@@ -174,8 +316,8 @@ static void addMatches(MatcherPrivate */*p*/, BestIndexMatches &bestIndexMatches
  * http://en.wikipedia.org/wiki/TF_IDF
  * http://en.wikipedia.org/wiki/Okapi_BM25
  */
-static double calculateRelevancy(MatcherPrivate *p, const WordID wID, const WordID indexID, int error) {
-    const LevenshteinIndex * const ind = p->indexes[indexID];
+static double calculateRelevancy(const MatcherPrivate *p, const WordID wID, const WordID indexID, int error) {
+    const LevenshteinIndex * const ind = p->indexes.find(indexID)->second;
     double errorMultiplier = 100.0/(100.0+error); // Should be adjusted for maxError or word length.
     size_t indexCount = ind->wordCount(wID);
     size_t indexMaxCount = ind->maxCount();
@@ -187,7 +329,80 @@ static double calculateRelevancy(MatcherPrivate *p, const WordID wID, const Word
 }
 
 
-static void matchIndexes(MatcherPrivate *p, const WordList &query, const SearchParameters &params, const int extraError, BestIndexMatches &bestIndexMatches) {
+static size_t numWorkers(const MatcherPrivate *p) {
+    return p->pool ? p->pool->size() : 1;
+}
+
+static void runTasks(const MatcherPrivate *p, ThreadTask &task, const size_t numTasks) {
+    if(p->pool) {
+        p->pool->run(task, numTasks);
+    } else {
+        for(size_t i=0; i<numTasks; i++)
+            task.execute(i, 0);
+    }
+}
+
+/*
+ * Searching one query word in one field index is a task of its own.
+ * Each worker compiles its own automaton for a query word and reuses
+ * it for all the fields it searches that word in. Searches that belong
+ * to a query session continue its incremental search instead, and
+ * prefix searches look for completions.
+ */
+struct IndexSearch {
+    size_t word;
+    WordID indexID;
+    const LevenshteinIndex *index;
+    IncrementalSearch *incremental; // Null when not in a session.
+    bool prefix;
+};
+
+class IndexSearchTask final : public ThreadTask {
+private:
+    const WordList &query;
+    const ErrorValues &e;
+    const vector<int> &maxErrors;
+    const vector<IndexSearch> &searches;
+    const size_t numWorkers;
+    vector<unique_ptr<LevenshteinAutomaton> > automata;
+
+public:
+    vector<unique_ptr<IndexMatches> > results;
+
+    IndexSearchTask(const WordList &query_, const ErrorValues &e_, const vector<int> &maxErrors_,
+            const vector<IndexSearch> &searches_, const size_t numWorkers_) :
+        query(query_), e(e_), maxErrors(maxErrors_), searches(searches_), numWorkers(numWorkers_),
+        automata(query_.size()*numWorkers_) {
+        for(size_t i=0; i<searches.size(); i++)
+            results.push_back(unique_ptr<IndexMatches>(new IndexMatches()));
+    }
+
+    void execute(const size_t task, const size_t worker) override {
+        const IndexSearch &s = searches[task];
+        if(s.prefix) {
+            s.index->findCompletions(query[s.word], e, maxErrors[s.word], *results[task]);
+            return;
+        }
+        if(s.incremental) {
+            s.index->findWords(*s.incremental, query[s.word], maxErrors[s.word], *results[task]);
+            return;
+        }
+        unique_ptr<LevenshteinAutomaton> &a = automata[s.word*numWorkers + worker];
+        if(!a)
+            a.reset(new LevenshteinAutomaton(query[s.word], e, maxErrors[s.word]));
+        s.index->findWords(*a, *results[task]);
+    }
+};
+
+/*
+ * Session searches are given per query word and index in the order of
+ * p->indexes. Null entries and an empty list mean regular searches.
+ */
+static void matchIndexes(const MatcherPrivate *p, const WordList &query, const SearchParameters &params, const int extraError,
+        BestIndexMatches &bestIndexMatches, const vector<IncrementalSearch*> &sessionSearches) {
+    vector<int> maxErrors;
+    vector<IndexSearch> searches;
+    size_t searchNum = 0;
     for(size_t i=0; i<query.size(); i++) {
         const Word &w = query[i];
         int maxError;
@@ -196,49 +411,191 @@ static void matchIndexes(MatcherPrivate *p, const WordList &query, const SearchP
         else
             maxError = 2*LevenshteinIndex::getDefaultError();
         maxError += extraError;
+        maxErrors.push_back(maxError);
 
-        for(IndIterator it = p->indexes.begin(); it != p->indexes.end(); it++) {
+        for(auto it = p->indexes.begin(); it != p->indexes.end(); it++, searchNum++) {
             if(params.isNonsearchingField(p->store.getWord(it->first))) {
                 continue;
             }
-            IndexMatches m;
-            it->second->findWords(w, p->e, maxError, m);
-            addMatches(p, bestIndexMatches, w, it->first, m);
-            debugMessage("Matched word %s in index %s with error %d and got %lu matches.\n",
-                    w.asUtf8().c_str(), p->store.getWord(it->first).asUtf8().c_str(), maxError, (unsigned long) m.size());
+            IndexSearch s;
+            s.word = i;
+            s.indexID = it->first;
+            s.index = it->second;
+            s.prefix = params.isLastWordPrefix() && i == query.size()-1;
+            s.incremental = sessionSearches.empty() || s.prefix ? nullptr : sessionSearches[searchNum];
+            searches.push_back(s);
         }
     }
+
+    IndexSearchTask task(query, p->e, maxErrors, searches, numWorkers(p));
+    runTasks(p, task, searches.size());
+    QueryStats *stats = params.getQueryStats();
+    // Merged in a fixed order so results do not depend on thread timing.
+    for(size_t i=0; i<searches.size(); i++) {
+        const Word &w = query[searches[i].word];
+        IndexMatches &m = *task.results[i];
+        if(stats)
+            stats->addIndexSearch(w, p->store.getWord(searches[i].indexID), m.getNodesVisited(),
+                    m.getCellsComputed(), m.size());
+        addMatches(p, bestIndexMatches, w, searches[i].indexID, m);
+        debugMessage("Matched word %s in index %s with error %d and got %lu matches.\n",
+                w.asUtf8().c_str(), p->store.getWord(searches[i].indexID).asUtf8().c_str(),
+                maxErrors[searches[i].word], (unsigned long) m.size());
+    }
 }
 
-static void gatherMatchedDocuments(MatcherPrivate *p,  BestIndexMatches &bestIndexMatches, map<DocumentID, double> &matchedDocuments) {
+/*
+ * Relevancies of the documents matched by one query, indexed by document
+ * ordinal. Every thread keeps one around between queries, so once it has
+ * grown to the number of documents scoring does not allocate. Only the
+ * touched entries are looked at or reset.
+ */
+struct ScoreAccumulator {
+    vector<double> scores;
+    vector<unsigned char> seen;
+    vector<DocumentOrdinal> touched;
+
+    void prepare(const size_t numDocuments) {
+        for(const auto &o : touched)
+            seen[o] = 0;
+        touched.clear();
+        if(scores.size() < numDocuments) {
+            scores.resize(numDocuments);
+            seen.resize(numDocuments, 0);
+        }
+    }
+
+    void add(const DocumentOrdinal o, const double relevancy) {
+        if(seen[o]) {
+            scores[o] += relevancy;
+        } else {
+            seen[o] = 1;
+            scores[o] = relevancy;
+            touched.push_back(o);
+        }
+    }
+};
+
+static thread_local ScoreAccumulator threadScores;
+
+static void gatherMatchedDocuments(const MatcherPrivate *p,  BestIndexMatches &bestIndexMatches, ScoreAccumulator &matchedDocuments,
+        QueryStats *stats) {
+    size_t postingsScanned = 0;
+    matchedDocuments.prepare(p->reverseIndex.numDocuments());
     for(MatchIndIterator it = bestIndexMatches.begin(); it != bestIndexMatches.end(); it++) {
         for(MatchIterator mIt = it->second.begin(); mIt != it->second.end(); mIt++) {
-            vector<DocumentID> tmp;
-            p->reverseIndex.findDocuments(mIt->first, it->first, tmp);
+            const PostingList *docs = p->reverseIndex.postings(mIt->first, it->first);
+            if(!docs)
+                continue;
             debugMessage("Exact searched \"%s\" in field \"%s\", which was found in %lu documents.\n",
                     p->store.getWord(mIt->first).asUtf8().c_str(),
-                    p->store.getWord(it->first).asUtf8().c_str(), (unsigned long)tmp.size());
-            for(size_t i=0; i<tmp.size(); i++) {
-                DocumentID curDoc = tmp[i];
-                // At this point we know the matched word, and which index and field
-                // it matched in. Now we can just increment the relevancy of said document.
-                double relevancy = calculateRelevancy(p, mIt->first, it->first, mIt->second);
-                auto doc = matchedDocuments.find(curDoc);
-                if(doc == matchedDocuments.end())
-                    matchedDocuments[curDoc] = relevancy;
-                else
-                    matchedDocuments[curDoc] += relevancy;
+                    p->store.getWord(it->first).asUtf8().c_str(), (unsigned long)docs->size());
+            // At this point we know the matched word, and which index and field
+            // it matched in. Now we can just increment the relevancy of said documents.
+            const double relevancy = calculateRelevancy(p, mIt->first, it->first, mIt->second);
+            for(PostingList::Iterator docIt = docs->begin(); !docIt.atEnd(); docIt.next()) {
+                matchedDocuments.add(docIt.get(), relevancy);
+                postingsScanned++;
             }
         }
     }
+    if(stats) {
+        stats->addPostingsScanned(postingsScanned);
+        stats->addDocumentsScored(matchedDocuments.touched.size());
+    }
 }
 
-static bool subtermsMatch(MatcherPrivate *p, const ResultFilter &filter, size_t term, DocumentID id) {
+static string indexBasename(const std::string &directory, const WordID indexID) {
+    return directory + "/index-" + to_string(indexID);
+}
+
+/*
+ * Every snapshot writes its data files into a new subdirectory. The
+ * matcher.snapshot file names it and is put in place with a rename, so
+ * it always points to one complete set of files. The subdirectories of
+ * earlier snapshots are removed after that. A reader that is still
+ * loading one then fails instead of mixing files from two snapshots.
+ */
+static const char snapshotDataPrefix[] = "data-";
+
+static void removeDataDirectory(const string &dirName) {
+    DIR *dir = opendir(dirName.c_str());
+    if(!dir)
+        return;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != nullptr) {
+        string fname(entry->d_name);
+        if(fname != "." && fname != "..")
+            unlink((dirName + "/" + fname).c_str());
+    }
+    closedir(dir);
+    rmdir(dirName.c_str());
+}
+
+static void removeOldData(const string &directory, const string &current) {
+    DIR *dir = opendir(directory.c_str());
+    if(!dir)
+        return;
+    vector<string> old;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != nullptr) {
+        string fname(entry->d_name);
+        if(fname.compare(0, strlen(snapshotDataPrefix), snapshotDataPrefix) == 0 && fname != current)
+            old.push_back(fname);
+    }
+    closedir(dir);
+    for(const auto &i : old)
+        removeDataDirectory(directory + "/" + i);
+}
+
+static string createDataDirectory(const string &directory) {
+    string dirTemplate = directory + "/" + snapshotDataPrefix + "XXXXXX";
+    vector<char> buf(dirTemplate.begin(), dirTemplate.end());
+    buf.push_back('\0');
+    if(!mkdtemp(buf.data())) {
+        string err("Could not create snapshot directory in ");
+        err += directory;
+        err += ": ";
+        err += strerror(errno);
+        throw runtime_error(err);
+    }
+    return string(buf.data() + directory.size() + 1);
+}
+
+static void saveOriginalSizes(const MatcherPrivate *p, SnapshotWriter &out) {
+    vector<uint64_t> docs;
+    vector<WordID> fields;
+    vector<uint64_t> sizes;
+    for(const auto &i : p->originalSizes) {
+        docs.push_back(i.first.first);
+        fields.push_back(i.first.second);
+        sizes.push_back(i.second);
+    }
+    out.writeArray(docs.data(), docs.size());
+    out.writeArray(fields.data(), fields.size());
+    out.writeArray(sizes.data(), sizes.size());
+}
+
+static void loadOriginalSizes(SnapshotReader &in, map<pair<DocumentID, WordID>, size_t> &originalSizes) {
+    size_t numDocs, numFields, numSizes;
+    const uint64_t *docs = in.readArray<uint64_t>(numDocs);
+    const WordID *fields = in.readArray<WordID>(numFields);
+    const uint64_t *sizes = in.readArray<uint64_t>(numSizes);
+    if(numDocs != numFields || numDocs != numSizes) {
+        throw runtime_error("Corrupt document sizes in snapshot.");
+    }
+    for(size_t i=0; i<numDocs; i++) {
+        // Saved in sorted order so every insertion goes to the end.
+        originalSizes.insert(originalSizes.end(), make_pair(make_pair(docs[i], fields[i]), sizes[i]));
+    }
+}
+
+static bool subtermsMatch(const MatcherPrivate *p, const ResultFilter &filter, size_t term, DocumentOrdinal ordinal) {
     for(size_t subTerm=0; subTerm < filter.numSubTerms(term); subTerm++) {
         const Word &filterName = filter.getField(term, subTerm);
         const Word &value = filter.getWord(term, subTerm);
         bool termFound = p->reverseIndex.documentHasTerm(
-                p->store.getID(value), p->store.getID(filterName), id);
+                p->store.findID(value), p->store.findID(filterName), ordinal);
         if(!termFound) {
             return false;
         }
@@ -246,13 +603,78 @@ static bool subtermsMatch(MatcherPrivate *p, const ResultFilter &filter, size_t
     return true;
 }
 
+static bool passesFilter(const MatcherPrivate *p, const ResultFilter &filter, DocumentOrdinal ordinal) {
+    for(size_t term=0; term < filter.numTerms(); term++) {
+        if(subtermsMatch(p, filter, term, ordinal))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Result order is decreasing relevancy, with ties broken by increasing
+ * document ID. This is the order MatchResults sorts results into when
+ * they are added in increasing document ID order.
+ */
+static bool betterResult(const pair<double, DocumentID> &a, const pair<double, DocumentID> &b) {
+    if(a.first != b.first)
+        return a.first > b.first;
+    return a.second < b.second;
+}
+
+/*
+ * Keeps the best maxResults documents in a heap whose top is the worst
+ * one kept. Documents that could not enter the heap are never run
+ * through the filter, which is the expensive part for large result sets.
+ *
+ * Relevancies are sums over every matched word and field, so a document's
+ * score is not known until all postings have been gathered. That rules
+ * out stopping the gathering early, only selection is bounded.
+ */
+static void selectBestResults(const MatcherPrivate *p, const ScoreAccumulator &docs,
+        const SearchParameters &params, MatchResults &matchedDocuments) {
+    const ResultFilter &filter = params.getResultFilter();
+    const size_t maxResults = params.getMaxResults();
+    size_t filtered = 0;
+    vector<pair<double, DocumentID> > heap;
+    heap.reserve(min(maxResults, docs.touched.size()));
+    for(const auto &o : docs.touched) {
+        const pair<double, DocumentID> candidate(docs.scores[o], p->reverseIndex.documentID(o));
+        if(heap.size() == maxResults && !betterResult(candidate, heap.front()))
+            continue;
+        if(!passesFilter(p, filter, o)) {
+            filtered++;
+            continue;
+        }
+        if(heap.size() == maxResults) {
+            pop_heap(heap.begin(), heap.end(), betterResult);
+            heap.pop_back();
+        }
+        heap.push_back(candidate);
+        push_heap(heap.begin(), heap.end(), betterResult);
+    }
+    // MatchResults keeps the order of ties, so add them in increasing ID order.
+    sort(heap.begin(), heap.end(), betterResult);
+    for(const auto &i : heap) {
+        matchedDocuments.addResult(i.second, i.first);
+    }
+    if(params.getQueryStats())
+        params.getQueryStats()->addDocumentsFiltered(filtered);
+}
+
 Matcher::Matcher() {
     p = new MatcherPrivate();
+    p->pool = nullptr;
+    p->generation = newGeneration();
+    p->succinctTries = false;
+    p->minimizedIndexes = false;
+    p->pending = nullptr;
 }
 
 void Matcher::index(const Corpus &c) {
     double buildStart, buildEnd;
     buildStart = hiresTimestamp();
+    p->generation = newGeneration();
     buildIndexes(c);
     buildEnd = hiresTimestamp();
     debugMessage("Added %lu documents to matcher. It now has %lu indexes. Index population took %.2f seconds.\n",
@@ -264,123 +686,452 @@ void Matcher::index(const Corpus &c) {
     }
 }
 
+/*
+ * Index building happens in three phases:
+ *
+ * 1. Chunks of documents are scanned in parallel. Each chunk collects its
+ *    own vocabulary in order of first occurrence and turns its texts into
+ *    chunk local word numbers.
+ * 2. The chunk vocabularies are given global WordIDs one chunk after the
+ *    other. This gives every word the same ID as adding the documents one
+ *    by one would, but only costs one lookup per distinct word per chunk.
+ *    Documents are given their ordinals in the same pass.
+ * 3. Every field index and its reverse index shard is filled in parallel
+ *    with the others, in document order.
+ */
+static const size_t BUILD_CHUNK_SIZE = 256;
+
+struct WordPtrHash {
+    size_t operator()(const Word *w) const { return w->hash(); }
+};
+
+struct WordPtrEqual {
+    bool operator()(const Word *w1, const Word *w2) const { return *w1 == *w2; }
+};
+
+struct FieldText {
+    DocumentID doc;
+    DocumentOrdinal ordinal; // Given out after scanning.
+    size_t field; // Chunk local word number of the field name.
+    size_t begin; // Range in the chunk's token list.
+    size_t end;
+};
+
+struct BuildChunk {
+    vector<const Word*> vocabulary;
+    vector<size_t> textCounts; // How many times each word appears in texts.
+    vector<size_t> tokens;
+    vector<FieldText> texts;
+    list<Word> ownedWords; // Words that do not outlive the scan elsewhere.
+    vector<WordID> globalIDs;
+};
+
+typedef hashmap<const Word*, size_t, WordPtrHash, WordPtrEqual> LocalVocabulary;
+
+static size_t localWordID(BuildChunk &chunk, LocalVocabulary &localIDs, const Word &w, const bool ownCopy) {
+    auto it = localIDs.find(&w);
+    if(it != localIDs.end())
+        return it->second;
+    const Word *stored = &w;
+    if(ownCopy) {
+        chunk.ownedWords.push_back(w);
+        stored = &chunk.ownedWords.back();
+    }
+    const size_t localID = chunk.vocabulary.size();
+    chunk.vocabulary.push_back(stored);
+    chunk.textCounts.push_back(0);
+    localIDs[stored] = localID;
+    return localID;
+}
+
+class ChunkScanTask final : public ThreadTask {
+private:
+    const Corpus &c;
+
+public:
+    vector<BuildChunk> chunks;
+
+    explicit ChunkScanTask(const Corpus &c_) : c(c_),
+        chunks((c_.size() + BUILD_CHUNK_SIZE - 1) / BUILD_CHUNK_SIZE) {}
+
+    void execute(const size_t task, const size_t /*worker*/) override {
+        BuildChunk &chunk = chunks[task];
+        LocalVocabulary localIDs;
+        const size_t last = min(c.size(), (task+1)*BUILD_CHUNK_SIZE);
+        for(size_t ci = task*BUILD_CHUNK_SIZE; ci < last; ci++) {
+            const Document &d = c.getDocument(ci);
+            WordList textNames;
+            d.getFieldNames(textNames);
+            for(size_t ti=0; ti < textNames.size(); ti++) {
+                const Word &fieldName = textNames[ti];
+                const WordList &words = d.getText(fieldName);
+                FieldText text;
+                text.doc = d.getID();
+                text.field = localWordID(chunk, localIDs, fieldName, true);
+                text.begin = chunk.tokens.size();
+                for(size_t wi=0; wi<words.size(); wi++) {
+                    const size_t localID = localWordID(chunk, localIDs, words[wi], false);
+                    chunk.textCounts[localID]++;
+                    chunk.tokens.push_back(localID);
+                }
+                text.end = chunk.tokens.size();
+                chunk.texts.push_back(text);
+            }
+        }
+    }
+};
+
+class FieldBuildTask final : public ThreadTask {
+private:
+    MatcherPrivate *p;
+    const vector<BuildChunk> &chunks;
+    const vector<WordID> &fields;
+
+public:
+    FieldBuildTask(MatcherPrivate *p_, const vector<BuildChunk> &chunks_, const vector<WordID> &fields_) :
+        p(p_), chunks(chunks_), fields(fields_) {}
+
+    void execute(const size_t task, const size_t /*worker*/) override {
+        const WordID fieldID = fields[task];
+        LevenshteinIndex *index = p->indexes.find(fieldID)->second;
+        const Word fieldName = p->store.getWord(fieldID);
+        for(const auto &chunk : chunks) {
+            for(const auto &text : chunk.texts) {
+                if(chunk.globalIDs[text.field] != fieldID)
+                    continue;
+                for(size_t i=text.begin; i<text.end; i++) {
+                    const size_t localID = chunk.tokens[i];
+                    const WordID wordID = chunk.globalIDs[localID];
+                    index->insertWord(*chunk.vocabulary[localID], wordID);
+                    p->stats.addedWordToIndex(wordID, fieldName);
+                    p->reverseIndex.add(wordID, fieldID, text.ordinal);
+                }
+            }
+        }
+        p->reverseIndex.finalizeField(fieldID);
+        if(p->minimizedIndexes)
+            index->minimize();
+        else if(p->succinctTries)
+            index->compact();
+        else
+            index->freeze();
+    }
+};
+
+/*
+ * Streamed text is looked up by the letters of its tokens, so a Word
+ * is only built the first time a token is seen. The keys point to
+ * copies of the letters in blocks that never move.
+ */
+struct LetterSpan {
+    const Letter *letters;
+    size_t length;
+};
+
+struct LetterSpanHash {
+    size_t operator()(const LetterSpan &s) const {
+        size_t result = 14695981039346656037ULL;
+        for(size_t i=0; i<s.length; i++) {
+            result ^= (uint32_t) s.letters[i];
+            result *= 1099511628211ULL;
+        }
+        return result;
+    }
+};
+
+struct LetterSpanEqual {
+    bool operator()(const LetterSpan &s1, const LetterSpan &s2) const {
+        return s1.length == s2.length && memcmp(s1.letters, s2.letters, s1.length*sizeof(Letter)) == 0;
+    }
+};
+
+typedef hashmap<LetterSpan, size_t, LetterSpanHash, LetterSpanEqual> SpanVocabulary;
+
+static const size_t LETTER_BLOCK_SIZE = 64*1024;
+
+/*
+ * Streamed text is collected into a single chunk that owns all of
+ * its words. Committing it runs the last two phases.
+ */
+struct PendingBuild {
+    vector<BuildChunk> chunks;
+    SpanVocabulary localIDs;
+    list<vector<Letter> > letterBlocks;
+    vector<Letter> fieldLetters; // Reused for looking up field names.
+    Tokenizer tokenizer;
+
+    PendingBuild() : chunks(1) {}
+};
+
+static const Letter* storeLetters(PendingBuild *pending, const Letter *letters, const size_t length) {
+    list<vector<Letter> > &blocks = pending->letterBlocks;
+    if(blocks.empty() || blocks.back().capacity() - blocks.back().size() < length) {
+        blocks.push_back(vector<Letter>());
+        blocks.back().reserve(max(length, LETTER_BLOCK_SIZE));
+    }
+    vector<Letter> &block = blocks.back();
+    const Letter *stored = block.data() + block.size();
+    block.insert(block.end(), letters, letters + length);
+    return stored;
+}
+
+/*
+ * The word is built from the letters unless one is given.
+ */
+static size_t localWordID(PendingBuild *pending, const Letter *letters, const size_t length, const Word *word) {
+    LetterSpan key;
+    key.letters = letters;
+    key.length = length;
+    auto it = pending->localIDs.find(key);
+    if(it != pending->localIDs.end())
+        return it->second;
+    BuildChunk &chunk = pending->chunks[0];
+    chunk.ownedWords.push_back(word ? *word : Word(letters, length));
+    key.letters = storeLetters(pending, letters, length);
+    const size_t localID = chunk.vocabulary.size();
+    chunk.vocabulary.push_back(&chunk.ownedWords.back());
+    chunk.textCounts.push_back(0);
+    pending->localIDs[key] = localID;
+    return localID;
+}
+
 Matcher::~Matcher() {
     for(IndIterator it = p->indexes.begin(); it != p->indexes.end(); it++) {
         delete it->second;
     }
+    delete p->pool;
+    delete p->pending;
     delete p;
 }
 
-void Matcher::buildIndexes(const Corpus &c) {
-    for(size_t ci = 0; ci < c.size(); ci++) {
-        const Document &d = c.getDocument(ci);
-        WordList textNames;
-        d.getFieldNames(textNames);
-        for(size_t ti=0; ti < textNames.size(); ti++) {
-            const Word &fieldName = textNames[ti];
-            const WordID fieldID = p->store.getID(fieldName);
-            const WordList &text = d.getText(fieldName);
-            pair<DocumentID, WordID> lengths;
-            lengths.first = d.getID();
-            lengths.second = fieldID;
-            p->originalSizes[lengths] = text.size();
-            for(size_t wi=0; wi<text.size(); wi++) {
-                const Word &word = text[wi];
-                const WordID wordID = p->store.getID(word);
-                p->stats.wordProcessed(wordID);
-                addToIndex(word, wordID, fieldID);
-                p->stats.addedWordToIndex(wordID, fieldName);
-                p->reverseIndex.add(wordID, fieldID, d.getID());
-            }
+static void buildChunks(MatcherPrivate *p, vector<BuildChunk> &chunks) {
+    vector<WordID> fields;
+    set<WordID> seenFields;
+    for(auto &chunk : chunks) {
+        chunk.globalIDs.resize(chunk.vocabulary.size());
+        for(size_t i=0; i<chunk.vocabulary.size(); i++) {
+            const WordID wordID = p->store.getID(*chunk.vocabulary[i]);
+            chunk.globalIDs[i] = wordID;
+            if(chunk.textCounts[i] > 0)
+                p->stats.wordsProcessed(wordID, chunk.textCounts[i]);
+        }
+        for(auto &text : chunk.texts) {
+            const WordID fieldID = chunk.globalIDs[text.field];
+            text.ordinal = p->reverseIndex.addDocument(text.doc);
+            p->originalSizes[make_pair(text.doc, fieldID)] = text.end - text.begin;
+            if(text.begin == text.end || seenFields.find(fieldID) != seenFields.end())
+                continue;
+            // Everything the field workers share is created up front.
+            seenFields.insert(fieldID);
+            fields.push_back(fieldID);
+            if(p->indexes.find(fieldID) == p->indexes.end())
+                p->indexes[fieldID] = new LevenshteinIndex();
+            p->reverseIndex.addField(fieldID);
         }
     }
+
+    p->store.freeze();
+
+    FieldBuildTask build(p, chunks, fields);
+    runTasks(p, build, fields.size());
+    if(p->succinctTries)
+        p->store.compact();
 }
 
-void Matcher::addToIndex(const Word &word, const WordID wordID, const WordID indexID) {
-    LevenshteinIndex *target;
-    IndIterator it = p->indexes.find(indexID);
-    if(it == p->indexes.end()) {
-        target = new LevenshteinIndex();
-        p->indexes[indexID] = target;
-    } else {
-        target = it->second;
+void Matcher::buildIndexes(const Corpus &c) {
+    ChunkScanTask scan(c);
+    runTasks(p, scan, scan.chunks.size());
+    buildChunks(p, scan.chunks);
+}
+
+void Matcher::addText(const DocumentID id, const Word &field, const char *textAsUtf8) {
+    if(!p->pending)
+        p->pending = new PendingBuild();
+    PendingBuild *pending = p->pending;
+    BuildChunk &chunk = pending->chunks[0];
+    Tokenizer &t = pending->tokenizer;
+    vector<Letter> &fieldLetters = pending->fieldLetters;
+    fieldLetters.clear();
+    for(unsigned int i=0; i<field.length(); i++)
+        fieldLetters.push_back(field[i]);
+    t.tokenize(textAsUtf8);
+    FieldText text;
+    text.doc = id;
+    text.field = localWordID(pending, fieldLetters.data(), fieldLetters.size(), &field);
+    text.begin = chunk.tokens.size();
+    for(size_t i=0; i<t.size(); i++) {
+        const TokenSpan &span = t[i];
+        const size_t localID = localWordID(pending, t.letters() + span.offset, span.length, nullptr);
+        chunk.textCounts[localID]++;
+        chunk.tokens.push_back(localID);
     }
-    target->insertWord(word, wordID);
+    text.end = chunk.tokens.size();
+    chunk.texts.push_back(text);
+}
+
+void Matcher::addText(const DocumentID id, const Word &field, const std::string &textAsUtf8) {
+    addText(id, field, textAsUtf8.c_str());
+}
+
+void Matcher::commit() {
+    if(!p->pending)
+        return;
+    unique_ptr<PendingBuild> pending(p->pending);
+    p->pending = nullptr;
+    p->generation = newGeneration();
+    buildChunks(p, pending->chunks);
+    debugMessage("Committed %lu texts to matcher. It now has %lu indexes.\n",
+            (unsigned long) pending->chunks[0].texts.size(), (unsigned long) p->indexes.size());
 }
 
+static size_t pendingMemoryUsage(const PendingBuild *pending) {
+    const BuildChunk &chunk = pending->chunks[0];
+    size_t letterMemory = listMemory(pending->letterBlocks) + vectorMemory(pending->fieldLetters);
+    for(const auto &block : pending->letterBlocks)
+        letterMemory += vectorMemory(block);
+    return vectorMemory(chunk.vocabulary) + vectorMemory(chunk.textCounts) +
+            vectorMemory(chunk.tokens) + vectorMemory(chunk.texts) +
+            listMemory(chunk.ownedWords) + hashMemory(pending->localIDs) + letterMemory;
+}
 
-void Matcher::relevancyMatch(const WordList &query, const SearchParameters &params, const int extraError, MatchResults &matchedDocuments) {
-    map<DocumentID, double> docs;
+MemoryUsage Matcher::memoryUsage() const {
+    MemoryUsage usage;
+    map<Word, size_t> fieldBytes;
+    size_t indexBytes = 0;
+    for(const auto &i : p->indexes) {
+        const size_t bytes = i.second->memoryUsage() + p->reverseIndex.fieldMemoryUsage(i.first);
+        fieldBytes[p->store.getWord(i.first)] = bytes;
+        indexBytes += bytes;
+    }
+    usage.addComponent("word store", p->store.memoryUsage());
+    usage.addComponent("field indexes", indexBytes);
+    usage.addComponent("document table", p->reverseIndex.documentMemoryUsage());
+    usage.addComponent("document sizes", treeMemory(p->originalSizes));
+    usage.addComponent("statistics", p->stats.memoryUsage());
+    if(p->pending)
+        usage.addComponent("pending text", pendingMemoryUsage(p->pending));
+    for(const auto &i : fieldBytes)
+        usage.addIndex(i.first, i.second);
+    return usage;
+}
+
+void Matcher::relevancyMatch(const WordList &query, const SearchParameters &params, const int extraError,
+        MatchResults &matchedDocuments, QuerySession *session) const {
+    ScoreAccumulator &docs = threadScores;
     BestIndexMatches bestIndexMatches;
+    QueryStats *stats = params.getQueryStats();
     double start, indexMatchEnd, gatherEnd, finish;
 
+    vector<IncrementalSearch*> sessionSearches;
     start = hiresTimestamp();
-    matchIndexes(p, query, params, extraError, bestIndexMatches);
+    if(session) {
+        session->bind(p->generation);
+        for(size_t i=0; i<query.size(); i++) {
+            for(auto it = p->indexes.begin(); it != p->indexes.end(); it++)
+                sessionSearches.push_back(&session->getSearch(i, it->first, p->e));
+        }
+    }
+    matchIndexes(p, query, params, extraError, bestIndexMatches, sessionSearches);
     indexMatchEnd = hiresTimestamp();
     // Now we know all matched words in all indexes. Gather up the corresponding documents.
-    gatherMatchedDocuments(p, bestIndexMatches, docs);
+    gatherMatchedDocuments(p, bestIndexMatches, docs, stats);
     gatherEnd = hiresTimestamp();
-    for(auto it=docs.begin(); it != docs.end(); it++) {
-        matchedDocuments.addResult(it->first, it->second);
+    if(params.getMaxResults() > 0) {
+        selectBestResults(p, docs, params, matchedDocuments);
+    } else {
+        auto &filter = params.getResultFilter();
+        const ReverseIndex &rev = p->reverseIndex;
+        size_t filtered = 0;
+        // MatchResults breaks relevancy ties by the order results were added in.
+        sort(docs.touched.begin(), docs.touched.end(), [&rev](DocumentOrdinal a, DocumentOrdinal b) {
+            return rev.documentID(a) < rev.documentID(b);
+        });
+        for(const auto &o : docs.touched) {
+            if(passesFilter(p, filter, o))
+                matchedDocuments.addResult(rev.documentID(o), docs.scores[o]);
+            else
+                filtered++;
+        }
+        if(stats)
+            stats->addDocumentsFiltered(filtered);
     }
     debugMessage("Found a total of %lu documents.\n", (unsigned long) matchedDocuments.size());
     finish = hiresTimestamp();
+    if(stats)
+        stats->addTimes(indexMatchEnd - start, gatherEnd - indexMatchEnd, finish - gatherEnd);
     debugMessage("Query finished. Index lookups took %.2fs, result gathering %.2fs, result building %.2fs.\n",
             indexMatchEnd - start, gatherEnd - indexMatchEnd, finish - gatherEnd);
 }
 
-MatchResults Matcher::match(const WordList &query, const SearchParameters &params) {
+MatchResults Matcher::match(const WordList &query, const SearchParameters &params) const {
     MatchResults matchedDocuments;
     const int maxIterations = 1;
     const int increment = LevenshteinIndex::getDefaultError();
     const size_t minMatches = 10;
-    MatchResults allMatches;
 
     if(query.size() == 0)
         return matchedDocuments;
     // Try to search with ever growing error until we find enough matches.
+    // Results come back already filtered.
     for(int i=0; i<maxIterations; i++) {
         MatchResults matches;
-        relevancyMatch(query, params, i*increment, matches);
+        relevancyMatch(query, params, i*increment, matches, nullptr);
         if(matches.size() >= minMatches || i == maxIterations-1) {
-            allMatches.addResults(matches);
+            matchedDocuments.addResults(matches);
             break;
         }
     }
-
-    /* Filter results into final set. */
-    auto &filter = params.getResultFilter();
-    for(size_t i=0; i<allMatches.size(); i++) {
-        DocumentID id = allMatches.getDocumentID(i);
-        for(size_t term=0; term < filter.numTerms(); term++) {
-            if(subtermsMatch(p, filter, term, id)) {
-                matchedDocuments.copyResult(allMatches, i);
-                break;
-            }
-        }
-    }
     return matchedDocuments;
 }
 
-MatchResults Matcher::match(const char *queryAsUtf8) {
+MatchResults Matcher::match(const char *queryAsUtf8) const {
     return match(splitToWords(queryAsUtf8));
 }
 
-MatchResults Matcher::match(const std::string &queryAsUtf8) {
+MatchResults Matcher::match(const std::string &queryAsUtf8) const {
     return match(queryAsUtf8.c_str());
 }
 
 
-MatchResults Matcher::match(const WordList &query) {
+MatchResults Matcher::match(const WordList &query) const {
     SearchParameters defaults;
     return match(query, defaults);
 }
 
+/*
+ * The non-const versions are kept for binary compatibility.
+ */
+MatchResults Matcher::match(const char *queryAsUtf8) {
+    return static_cast<const Matcher*>(this)->match(queryAsUtf8);
+}
+
+MatchResults Matcher::match(const WordList &query) {
+    return static_cast<const Matcher*>(this)->match(query);
+}
+
+MatchResults Matcher::match(const std::string &queryAsUtf8) {
+    return static_cast<const Matcher*>(this)->match(queryAsUtf8);
+}
+
+MatchResults Matcher::match(const char *queryAsUtf8, const SearchParameters &params) {
+    return static_cast<const Matcher*>(this)->match(queryAsUtf8, params);
+}
+
+MatchResults Matcher::match(const WordList &query, const SearchParameters &params) {
+    return static_cast<const Matcher*>(this)->match(query, params);
+}
+
+MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryIndex) {
+    return static_cast<const Matcher*>(this)->onlineMatch(query, primaryIndex);
+}
+
 ErrorValues& Matcher::getErrorValues() {
+    // The caller may change the error values through the reference.
+    p->generation = newGeneration();
     return p->e;
 }
 
-MatchResults Matcher::match(const char *queryAsUtf8, const SearchParameters &params) {
+MatchResults Matcher::match(const char *queryAsUtf8, const SearchParameters &params) const {
     return match(splitToWords(queryAsUtf8), params);
 }
 
@@ -388,14 +1139,45 @@ IndexWeights& Matcher::getIndexWeights() {
     return p->weights;
 }
 
-static map<DocumentID, size_t> countExacts(MatcherPrivate *p, const WordList &query, const WordID indexID) {
+void Matcher::setThreadCount(const size_t numThreads) {
+    if(numThreads == 0) {
+        throw invalid_argument("Thread count must be at least one.");
+    }
+    if(numThreads == getThreadCount())
+        return;
+    ThreadPool *newPool = numThreads > 1 ? new ThreadPool(numThreads) : nullptr;
+    delete p->pool;
+    p->pool = newPool;
+}
+
+size_t Matcher::getThreadCount() const {
+    return p->pool ? p->pool->size() : 1;
+}
+
+void Matcher::setSuccinctTries(const bool succinct) {
+    p->succinctTries = succinct;
+}
+
+bool Matcher::getSuccinctTries() const {
+    return p->succinctTries;
+}
+
+void Matcher::setMinimizedIndexes(const bool minimized) {
+    p->minimizedIndexes = minimized;
+}
+
+bool Matcher::getMinimizedIndexes() const {
+    return p->minimizedIndexes;
+}
+
+static map<DocumentID, size_t> countExacts(const MatcherPrivate *p, const WordList &query, const WordID indexID) {
     map<DocumentID, size_t> matchCounts;
     for(size_t i=0; i<query.size(); i++) {
         const Word &w = query[i];
         if(w.length() == 0 || !p->store.hasWord(w)) {
             continue;
         }
-        WordID curWord = p->store.getID(w);
+        WordID curWord = p->store.findID(w);
         vector<DocumentID> exacts;
         p->reverseIndex.findDocuments(curWord, indexID, exacts);
         for(const auto &i : exacts) {
@@ -410,7 +1192,20 @@ struct DocCount {
     size_t matches;
 };
 
-MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryIndex) {
+static size_t originalSize(const MatcherPrivate *p, const DocumentID id, const WordID indexID) {
+    auto it = p->originalSizes.find(make_pair(id, indexID));
+    return it == p->originalSizes.end() ? 0 : it->second;
+}
+
+MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryIndex) const {
+    return onlineMatch(query, primaryIndex, nullptr);
+}
+
+MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryIndex, QuerySession &session) const {
+    return onlineMatch(query, primaryIndex, &session);
+}
+
+MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryIndex, QuerySession *session) const {
     MatchResults results;
     set<DocumentID> exactMatched;
     map<DocumentID, double> accumulator;
@@ -420,7 +1215,7 @@ MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryInde
         msg += " is not known";
         throw invalid_argument(msg);
     }
-    WordID indexID = p->store.getID(primaryIndex);
+    WordID indexID = p->store.findID(primaryIndex);
     // How many times each document matched with zero error.
     vector<DocCount> stats;
     for(const auto &i : countExacts(p, query, indexID)) {
@@ -436,12 +1231,15 @@ MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryInde
     for(const auto &i: stats) {
         accumulator[i.id] = 2*i.matches;
         if(i.matches == query.size()
-                && i.matches == p->originalSizes[make_pair(i.id, indexID)]) { // Perfect match.
+                && i.matches == originalSize(p, i.id, indexID)) { // Perfect match.
             accumulator[i.id] += 100;
         }
     }
-    // Merge in fuzzy matches.
-    MatchResults fuzzyResults = match(query);
+    // Merge in fuzzy matches. This is match(query) with the session passed on.
+    SearchParameters defaults;
+    MatchResults fuzzyResults;
+    if(query.size() > 0)
+        relevancyMatch(query, defaults, 0, fuzzyResults, session);
     for(size_t i = 0; i<fuzzyResults.size(); i++) {
         DocumentID docid = fuzzyResults.getDocumentID(i);
         accumulator[docid] += fuzzyResults.getRelevancy(i);
@@ -452,5 +1250,77 @@ MatchResults Matcher::onlineMatch(const WordList &query, const Word &primaryInde
     return results;
 }
 
+void Matcher::saveSnapshot(const std::string &directory) const {
+    vector<WordID> indexIDs;
+    if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        string err("Could not create snapshot directory ");
+        err += directory;
+        err += ": ";
+        err += strerror(errno);
+        throw runtime_error(err);
+    }
+    const string dataName = createDataDirectory(directory);
+    const string data = directory + "/" + dataName;
+    try {
+        p->store.save(data + "/words");
+        for(const auto &i : p->indexes) {
+            i.second->save(indexBasename(data, i.first));
+            indexIDs.push_back(i.first);
+        }
+        SnapshotWriter out(directory + "/matcher.snapshot", "matcher");
+        out.writeArray(dataName.data(), dataName.size());
+        out.writeArray(indexIDs.data(), indexIDs.size());
+        p->reverseIndex.save(out);
+        saveOriginalSizes(p, out);
+        p->stats.save(out);
+        out.finish();
+    } catch(...) {
+        removeDataDirectory(data);
+        throw;
+    }
+    removeOldData(directory, dataName);
+}
+
+void Matcher::loadSnapshot(const std::string &directory) {
+    SnapshotReader in(directory + "/matcher.snapshot", "matcher");
+    IndexMap newIndexes;
+    ReverseIndex newReverseIndex;
+    map<pair<DocumentID, WordID>, size_t> newSizes;
+    MatcherStatistics newStats;
+    size_t nameLength, numIndexes;
+    const char *nameChars = in.readArray<char>(nameLength);
+    const string dataName(nameChars, nameLength);
+    if(dataName.empty() || dataName.find('/') != string::npos) {
+        throw runtime_error("Corrupt data directory name in snapshot " + directory + ".");
+    }
+    const string data = directory + "/" + dataName;
+    const WordID *indexIDs = in.readArray<WordID>(numIndexes);
+    try {
+        for(size_t i=0; i<numIndexes; i++) {
+            LevenshteinIndex *ind = new LevenshteinIndex();
+            newIndexes[indexIDs[i]] = ind;
+            ind->load(indexBasename(data, indexIDs[i]));
+        }
+        newReverseIndex.load(in);
+        loadOriginalSizes(in, newSizes);
+        newStats.load(in);
+        p->store.load(data + "/words");
+    } catch(...) {
+        for(auto &i : newIndexes) {
+            delete i.second;
+        }
+        throw;
+    }
+    // Everything loaded, nothing below can fail.
+    for(auto &i : p->indexes) {
+        delete i.second;
+    }
+    p->indexes.swap(newIndexes);
+    swap(p->reverseIndex, newReverseIndex);
+    p->originalSizes.swap(newSizes);
+    p->stats.swap(newStats);
+    p->generation = newGeneration();
+}
+
 COL_NAMESPACE_END
 
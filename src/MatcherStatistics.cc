@@ -19,6 +19,10 @@
 
 #include "Word.hh"
 #include "MatcherStatistics.hh"
+#include "SnapshotFile.hh"
+#include "ContainerMemory.hh"
+#include <vector>
+#include <stdexcept>
 
 #ifdef HAS_SPARSE_HASH
 #include <google/sparse_hash_map>
@@ -46,11 +50,15 @@ MatcherStatistics::~MatcherStatistics() {
 }
 
 void MatcherStatistics::wordProcessed(const WordID w) {
+    wordsProcessed(w, 1);
+}
+
+void MatcherStatistics::wordsProcessed(const WordID w, const size_t count) {
     auto it = p->totalWordCounts.find(w);
     if(it == p->totalWordCounts.end()) {
-        p->totalWordCounts[w] = 1;
+        p->totalWordCounts[w] = count;
     } else {
-        it->second++;
+        it->second += count;
     }
 }
 
@@ -68,4 +76,41 @@ void MatcherStatistics::addedWordToIndex(const WordID /*word*/, const Word &/*fi
     // Doesn't do anything yet.
 }
 
+size_t MatcherStatistics::memoryUsage() const {
+    return hashMemory(p->totalWordCounts);
+}
+
+void MatcherStatistics::save(SnapshotWriter &out) const {
+    vector<WordID> ids;
+    vector<uint64_t> counts;
+    ids.reserve(p->totalWordCounts.size());
+    counts.reserve(p->totalWordCounts.size());
+    for(const auto &i : p->totalWordCounts) {
+        ids.push_back(i.first);
+        counts.push_back(i.second);
+    }
+    out.writeArray(ids.data(), ids.size());
+    out.writeArray(counts.data(), counts.size());
+}
+
+void MatcherStatistics::load(SnapshotReader &in) {
+    size_t numIDs, numCounts;
+    hashmap<WordID, size_t> newCounts;
+    const WordID *ids = in.readArray<WordID>(numIDs);
+    const uint64_t *counts = in.readArray<uint64_t>(numCounts);
+    if(numIDs != numCounts) {
+        throw runtime_error("Corrupt word statistics in snapshot.");
+    }
+    for(size_t i=0; i<numIDs; i++) {
+        newCounts[ids[i]] = counts[i];
+    }
+    p->totalWordCounts.swap(newCounts);
+}
+
+void MatcherStatistics::swap(MatcherStatistics &other) {
+    MatcherStatisticsPrivate *tmp = p;
+    p = other.p;
+    other.p = tmp;
+}
+
 COL_NAMESPACE_END
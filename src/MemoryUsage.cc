@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MemoryUsage.hh"
+#include "Word.hh"
+#include <vector>
+#include <stdexcept>
+
+COL_NAMESPACE_START
+using namespace std;
+
+struct MemoryUsagePrivate {
+    vector<pair<string, size_t> > components;
+    vector<pair<Word, size_t> > indexes;
+};
+
+MemoryUsage::MemoryUsage() {
+    p = new MemoryUsagePrivate();
+}
+
+MemoryUsage::~MemoryUsage() {
+    delete p;
+}
+
+MemoryUsage::MemoryUsage(const MemoryUsage &other) {
+    p = new MemoryUsagePrivate();
+    *p = *other.p;
+}
+
+MemoryUsage::MemoryUsage(MemoryUsage &&other) {
+    p = other.p;
+    other.p = nullptr;
+}
+
+const MemoryUsage& MemoryUsage::operator=(MemoryUsage &&other) {
+    if(this != &other) {
+        delete p;
+        p = other.p;
+        other.p = nullptr;
+    }
+    return *this;
+}
+
+const MemoryUsage& MemoryUsage::operator=(const MemoryUsage &other) {
+    if(this != &other) {
+        *p = *other.p;
+    }
+    return *this;
+}
+
+void MemoryUsage::addComponent(const std::string &name, const size_t bytes) {
+    p->components.push_back(make_pair(name, bytes));
+}
+
+void MemoryUsage::addIndex(const Word &field, const size_t bytes) {
+    p->indexes.push_back(make_pair(field, bytes));
+}
+
+size_t MemoryUsage::numComponents() const {
+    return p->components.size();
+}
+
+const std::string& MemoryUsage::getComponentName(const size_t i) const {
+    if(i >= p->components.size()) {
+        throw out_of_range("Access out of bounds in MemoryUsage::getComponentName.");
+    }
+    return p->components[i].first;
+}
+
+size_t MemoryUsage::getComponentBytes(const size_t i) const {
+    if(i >= p->components.size()) {
+        throw out_of_range("Access out of bounds in MemoryUsage::getComponentBytes.");
+    }
+    return p->components[i].second;
+}
+
+size_t MemoryUsage::numIndexes() const {
+    return p->indexes.size();
+}
+
+const Word& MemoryUsage::getIndexField(const size_t i) const {
+    if(i >= p->indexes.size()) {
+        throw out_of_range("Access out of bounds in MemoryUsage::getIndexField.");
+    }
+    return p->indexes[i].first;
+}
+
+size_t MemoryUsage::getIndexBytes(const size_t i) const {
+    if(i >= p->indexes.size()) {
+        throw out_of_range("Access out of bounds in MemoryUsage::getIndexBytes.");
+    }
+    return p->indexes[i].second;
+}
+
+size_t MemoryUsage::getTotal() const {
+    size_t total = 0;
+    for(const auto &c : p->components)
+        total += c.second;
+    return total;
+}
+
+COL_NAMESPACE_END
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PostingList.hh"
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+COL_NAMESPACE_START
+using namespace std;
+
+static const size_t SKIP_ENTRY_SIZE = sizeof(DocumentID) + sizeof(uint32_t);
+static const size_t MAX_VARINT_SIZE = (sizeof(DocumentID)*8 + 6) / 7;
+
+PostingList::PostingList() :
+    data(nullptr), used(0), capacity(0), count(0), numSkips(0), last(0),
+    pending(nullptr), numPending(0), pendingCapacity(0) {
+}
+
+PostingList::~PostingList() {
+    delete []data;
+    delete []pending;
+}
+
+PostingList::PostingList(const PostingList &other) :
+    data(nullptr), used(other.used), capacity(0), count(other.count), numSkips(other.numSkips),
+    last(other.last), pending(nullptr), numPending(other.numPending), pendingCapacity(0) {
+    const size_t bytes = used + numSkips*SKIP_ENTRY_SIZE;
+    if(bytes > 0) {
+        data = new unsigned char[bytes];
+        capacity = bytes;
+        memcpy(data, other.data, bytes);
+    }
+    if(numPending > 0) {
+        pending = new DocumentID[numPending];
+        pendingCapacity = numPending;
+        memcpy(pending, other.pending, numPending*sizeof(DocumentID));
+    }
+}
+
+PostingList::PostingList(PostingList &&other) : PostingList() {
+    swap(other);
+}
+
+PostingList& PostingList::operator=(PostingList other) {
+    swap(other);
+    return *this;
+}
+
+void PostingList::swap(PostingList &other) {
+    std::swap(data, other.data);
+    std::swap(used, other.used);
+    std::swap(capacity, other.capacity);
+    std::swap(count, other.count);
+    std::swap(numSkips, other.numSkips);
+    std::swap(last, other.last);
+    std::swap(pending, other.pending);
+    std::swap(numPending, other.numPending);
+    std::swap(pendingCapacity, other.pendingCapacity);
+}
+
+void PostingList::clear() {
+    delete []data;
+    delete []pending;
+    data = nullptr;
+    pending = nullptr;
+    used = capacity = count = numSkips = numPending = pendingCapacity = 0;
+    last = 0;
+}
+
+void PostingList::reserve(const size_t bytes) {
+    if(bytes <= capacity)
+        return;
+    size_t newCapacity = capacity < 16 ? 16 : capacity;
+    while(newCapacity < bytes)
+        newCapacity *= 2;
+    unsigned char *newData = new unsigned char[newCapacity];
+    if(used > 0)
+        memcpy(newData, data, used);
+    delete []data;
+    data = newData;
+    capacity = newCapacity;
+}
+
+void PostingList::append(const DocumentID id) {
+    DocumentID delta = id - last;
+    // Appending overwrites the skip table, it is rebuilt on finalize.
+    numSkips = 0;
+    reserve(used + MAX_VARINT_SIZE);
+    while(delta >= 0x80) {
+        data[used++] = (unsigned char)(delta | 0x80);
+        delta >>= 7;
+    }
+    data[used++] = (unsigned char)delta;
+    last = id;
+    count++;
+}
+
+void PostingList::add(const DocumentID id) {
+    if(count == 0 || id > last) {
+        append(id);
+        return;
+    }
+    if(id == last)
+        return;
+    if(numPending == pendingCapacity) {
+        uint32_t newCapacity = pendingCapacity == 0 ? 4 : 2*pendingCapacity;
+        DocumentID *newPending = new DocumentID[newCapacity];
+        if(numPending > 0)
+            memcpy(newPending, pending, numPending*sizeof(DocumentID));
+        delete []pending;
+        pending = newPending;
+        pendingCapacity = newCapacity;
+    }
+    pending[numPending++] = id;
+}
+
+void PostingList::skipEntry(const size_t i, DocumentID &value, uint32_t &offset) const {
+    const unsigned char *entry = data + used + i*SKIP_ENTRY_SIZE;
+    memcpy(&value, entry, sizeof(value));
+    memcpy(&offset, entry + sizeof(value), sizeof(offset));
+}
+
+void PostingList::buildSkipTable() {
+    const size_t entries = count > SKIP_INTERVAL ? (count + SKIP_INTERVAL - 1) / SKIP_INTERVAL : 0;
+    const size_t bytes = used + entries*SKIP_ENTRY_SIZE;
+    // Also shrinks the buffer to its exact size.
+    unsigned char *newData = bytes > 0 ? new unsigned char[bytes] : nullptr;
+    if(used > 0)
+        memcpy(newData, data, used);
+    delete []data;
+    data = newData;
+    capacity = bytes;
+    numSkips = 0;
+    if(entries == 0)
+        return;
+    unsigned char *entry = data + used;
+    size_t i = 0;
+    for(Iterator it = first(); !it.atEnd(); it.next(), i++) {
+        if(i % SKIP_INTERVAL != 0)
+            continue;
+        const DocumentID value = it.get();
+        const uint32_t offset = it.pos - data;
+        memcpy(entry, &value, sizeof(value));
+        memcpy(entry + sizeof(value), &offset, sizeof(offset));
+        entry += SKIP_ENTRY_SIZE;
+    }
+    numSkips = entries;
+}
+
+void PostingList::finalize() {
+    if(numPending > 0) {
+        DocumentID *ids = new DocumentID[count + numPending];
+        size_t numIDs = 0;
+        for(Iterator it = first(); !it.atEnd(); it.next())
+            ids[numIDs++] = it.get();
+        memcpy(ids + numIDs, pending, numPending*sizeof(DocumentID));
+        numIDs += numPending;
+        sort(ids, ids + numIDs);
+        numIDs = unique(ids, ids + numIDs) - ids;
+        clear();
+        for(size_t i=0; i<numIDs; i++)
+            append(ids[i]);
+        delete []ids;
+    }
+    if(pending) {
+        delete []pending;
+        pending = nullptr;
+        pendingCapacity = 0;
+    }
+    buildSkipTable();
+}
+
+void PostingList::checkFinalized() const {
+    if(numPending > 0) {
+        throw logic_error("Posting list must be finalized before iterating.");
+    }
+}
+
+size_t PostingList::size() const {
+    checkFinalized();
+    return count;
+}
+
+PostingList::Iterator PostingList::first() const {
+    Iterator it;
+    it.list = this;
+    it.pos = data;
+    it.index = 0;
+    it.value = 0;
+    if(count > 0)
+        it.value = readVarint(it.pos);
+    return it;
+}
+
+PostingList::Iterator PostingList::begin() const {
+    checkFinalized();
+    return first();
+}
+
+bool PostingList::contains(const DocumentID id) const {
+    for(uint32_t i=0; i<numPending; i++) {
+        if(pending[i] == id)
+            return true;
+    }
+    Iterator it = first();
+    it.skipTo(id);
+    return !it.atEnd() && it.get() == id;
+}
+
+void PostingList::Iterator::skipTo(const DocumentID target) {
+    if(atEnd() || value >= target)
+        return;
+    if(list->numSkips > 0) {
+        // Last skip entry not above the target.
+        size_t low = 0;
+        size_t high = list->numSkips;
+        while(high - low > 1) {
+            const size_t mid = (low + high) / 2;
+            DocumentID midValue;
+            uint32_t midOffset;
+            list->skipEntry(mid, midValue, midOffset);
+            if(midValue <= target)
+                low = mid;
+            else
+                high = mid;
+        }
+        if(low*SKIP_INTERVAL > index) {
+            uint32_t offset;
+            list->skipEntry(low, value, offset);
+            index = low*SKIP_INTERVAL;
+            pos = list->data + offset;
+        }
+    }
+    while(!atEnd() && value < target)
+        next();
+}
+
+size_t PostingList::memoryUsage() const {
+    return sizeof(PostingList) + capacity + pendingCapacity*sizeof(DocumentID);
+}
+
+COL_NAMESPACE_END
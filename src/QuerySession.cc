@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "QuerySession.hh"
+#include "IncrementalSearch.hh"
+#include <map>
+#include <memory>
+
+COL_NAMESPACE_START
+using namespace std;
+
+struct QuerySessionPrivate {
+    size_t generation; // Of the matcher the searches belong to.
+    map<pair<size_t, WordID>, unique_ptr<IncrementalSearch> > searches; // Query word number and field.
+};
+
+QuerySession::QuerySession() {
+    p = new QuerySessionPrivate();
+    p->generation = 0;
+}
+
+QuerySession::~QuerySession() {
+    delete p;
+}
+
+void QuerySession::reset() {
+    p->generation = 0;
+    p->searches.clear();
+}
+
+void QuerySession::bind(const size_t generation) {
+    if(p->generation != generation) {
+        reset();
+        p->generation = generation;
+    }
+}
+
+IncrementalSearch& QuerySession::getSearch(const size_t word, const WordID indexID, const ErrorValues &e) {
+    unique_ptr<IncrementalSearch> &s = p->searches[make_pair(word, indexID)];
+    if(!s)
+        s.reset(new IncrementalSearch(e));
+    return *s;
+}
+
+COL_NAMESPACE_END
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "QueryStats.hh"
+#include "Word.hh"
+#include <map>
+
+COL_NAMESPACE_START
+using namespace std;
+
+struct QueryStatsPrivate {
+    map<Word, size_t> nodesPerField;
+    map<Word, size_t> candidatesPerWord;
+    size_t nodesVisited;
+    size_t cellsComputed;
+    size_t postingsScanned;
+    size_t documentsScored;
+    size_t documentsFiltered;
+    double indexMatchTime;
+    double gatherTime;
+    double resultTime;
+};
+
+QueryStats::QueryStats() {
+    p = new QueryStatsPrivate();
+    clear();
+}
+
+QueryStats::~QueryStats() {
+    delete p;
+}
+
+void QueryStats::clear() {
+    p->nodesPerField.clear();
+    p->candidatesPerWord.clear();
+    p->nodesVisited = 0;
+    p->cellsComputed = 0;
+    p->postingsScanned = 0;
+    p->documentsScored = 0;
+    p->documentsFiltered = 0;
+    p->indexMatchTime = 0;
+    p->gatherTime = 0;
+    p->resultTime = 0;
+}
+
+void QueryStats::addIndexSearch(const Word &queryWord, const Word &field, const size_t nodesVisited,
+        const size_t cellsComputed, const size_t candidates) {
+    p->nodesPerField[field] += nodesVisited;
+    p->candidatesPerWord[queryWord] += candidates;
+    p->nodesVisited += nodesVisited;
+    p->cellsComputed += cellsComputed;
+}
+
+void QueryStats::addPostingsScanned(const size_t postings) {
+    p->postingsScanned += postings;
+}
+
+void QueryStats::addDocumentsScored(const size_t documents) {
+    p->documentsScored += documents;
+}
+
+void QueryStats::addDocumentsFiltered(const size_t documents) {
+    p->documentsFiltered += documents;
+}
+
+void QueryStats::addTimes(const double indexMatch, const double gather, const double results) {
+    p->indexMatchTime += indexMatch;
+    p->gatherTime += gather;
+    p->resultTime += results;
+}
+
+size_t QueryStats::getNodesVisited() const {
+    return p->nodesVisited;
+}
+
+size_t QueryStats::getNodesVisited(const Word &field) const {
+    auto it = p->nodesPerField.find(field);
+    return it == p->nodesPerField.end() ? 0 : it->second;
+}
+
+size_t QueryStats::getCellsComputed() const {
+    return p->cellsComputed;
+}
+
+size_t QueryStats::getCandidateWords(const Word &queryWord) const {
+    auto it = p->candidatesPerWord.find(queryWord);
+    return it == p->candidatesPerWord.end() ? 0 : it->second;
+}
+
+size_t QueryStats::getPostingsScanned() const {
+    return p->postingsScanned;
+}
+
+size_t QueryStats::getDocumentsScored() const {
+    return p->documentsScored;
+}
+
+size_t QueryStats::getDocumentsFiltered() const {
+    return p->documentsFiltered;
+}
+
+double QueryStats::getIndexMatchTime() const {
+    return p->indexMatchTime;
+}
+
+double QueryStats::getGatherTime() const {
+    return p->gatherTime;
+}
+
+double QueryStats::getResultTime() const {
+    return p->resultTime;
+}
+
+COL_NAMESPACE_END
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RowKernel.hh"
+#include <climits>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ROW_KERNEL_X86
+#include <immintrin.h>
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+COL_NAMESPACE_START
+using namespace std;
+
+static const int ROW_INFINITY = INT_MAX;
+
+/*
+ * Transpositions are only possible where the query contains the two
+ * latest trie letters in swapped order so they are patched in afterwards.
+ * This must happen before the insertion scan, since an insertion can
+ * follow a transposition.
+ */
+static inline void addTranspositions(const ErrorRowInput &in, int *row) {
+    if(!in.beforePrevious)
+        return;
+    for(size_t i=2; i<=in.queryLength; i++) {
+        if(in.query[i-1] == in.previousLetter && in.query[i-2] == in.letter) {
+            const int transposeError = in.beforePrevious[i-2] + in.transposeError;
+            if(transposeError < row[i])
+                row[i] = transposeError;
+        }
+    }
+}
+
+static inline int lastColumnError(const ErrorRowInput &in) {
+    const size_t n = in.queryLength;
+    return min(in.previous[n] + in.endDeletionError,
+            in.previous[n-1] + in.substituteErrors[n-1]);
+}
+
+static inline void baseErrorsScalar(const ErrorRowInput &in, int *row, size_t from) {
+    for(size_t i=from; i<in.queryLength; i++) {
+        row[i] = min(in.previous[i] + in.deletionError,
+                in.previous[i-1] + in.substituteErrors[i-1]);
+    }
+    row[in.queryLength] = lastColumnError(in);
+}
+
+static inline void insertionScanScalar(const ErrorRowInput &in, int *row, size_t from) {
+    for(size_t i=from; i<=in.queryLength; i++) {
+        const int insertError = row[i-1] + in.insertionError;
+        if(insertError < row[i])
+            row[i] = insertError;
+    }
+}
+
+static void errorRowScalar(const ErrorRowInput &in, int *row) {
+    if(in.queryLength == 0)
+        return;
+    baseErrorsScalar(in, row, 1);
+    addTranspositions(in, row);
+    insertionScanScalar(in, row, 1);
+}
+
+static bool gatherScalar(const int *lutRow, const size_t lutLetters,
+        const Letter *query, const size_t length, int *errors) {
+    for(size_t i=0; i<length; i++) {
+        if(query[i] >= lutLetters)
+            return false;
+        errors[i] = lutRow[query[i]];
+    }
+    return true;
+}
+
+#ifdef ROW_KERNEL_X86
+
+/*
+ * Processes four columns starting at i. Returns the next column.
+ */
+static inline TARGET_SSE41 size_t baseErrorsSSE41(const ErrorRowInput &in, int *row, size_t i) {
+    const __m128i deletion = _mm_set1_epi32(in.deletionError);
+    for(; i+4 <= in.queryLength; i+=4) {
+        __m128i del = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(in.previous + i)), deletion);
+        __m128i sub = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(in.previous + i - 1)),
+                _mm_loadu_si128((const __m128i*)(in.substituteErrors + i - 1)));
+        _mm_storeu_si128((__m128i*)(row + i), _mm_min_epi32(del, sub));
+    }
+    return i;
+}
+
+/*
+ * Prefix minimum of row[j] - j*insertionError in blocks of four.
+ * The carry is the minimum of everything to the left of the block.
+ */
+static inline TARGET_SSE41 size_t insertionScanSSE41(const ErrorRowInput &in, int *row, size_t i) {
+    const __m128i inf = _mm_set1_epi32(ROW_INFINITY);
+    const __m128i step = _mm_set1_epi32(4*in.insertionError);
+    const int ins = in.insertionError;
+    const int first = (int)i;
+    __m128i offsets = _mm_setr_epi32(first*ins, (first+1)*ins, (first+2)*ins, (first+3)*ins);
+    int carry = row[i-1] - (first-1)*ins;
+    for(; i+4 <= in.queryLength+1; i+=4) {
+        __m128i x = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(row + i)), offsets);
+        x = _mm_min_epi32(x, _mm_alignr_epi8(x, inf, 12));
+        x = _mm_min_epi32(x, _mm_alignr_epi8(x, inf, 8));
+        x = _mm_min_epi32(x, _mm_set1_epi32(carry));
+        carry = _mm_extract_epi32(x, 3);
+        _mm_storeu_si128((__m128i*)(row + i), _mm_add_epi32(x, offsets));
+        offsets = _mm_add_epi32(offsets, step);
+    }
+    return i;
+}
+
+static TARGET_SSE41 void errorRowSSE41(const ErrorRowInput &in, int *row) {
+    if(in.queryLength == 0)
+        return;
+    // The last column has a different deletion cost so it is always scalar.
+    baseErrorsScalar(in, row, baseErrorsSSE41(in, row, 1));
+    addTranspositions(in, row);
+    insertionScanScalar(in, row, insertionScanSSE41(in, row, 1));
+}
+
+static TARGET_AVX2 void errorRowAVX2(const ErrorRowInput &in, int *row) {
+    if(in.queryLength == 0)
+        return;
+    const size_t n = in.queryLength;
+    const int ins = in.insertionError;
+    const __m256i deletion = _mm256_set1_epi32(in.deletionError);
+    const __m256i inf = _mm256_set1_epi32(ROW_INFINITY);
+    const __m256i step = _mm256_set1_epi32(8*ins);
+    const __m256i lastOfLowLane = _mm256_set1_epi32(3);
+    size_t i = 1;
+
+    for(; i+8 <= n; i+=8) {
+        __m256i del = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(in.previous + i)), deletion);
+        __m256i sub = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(in.previous + i - 1)),
+                _mm256_loadu_si256((const __m256i*)(in.substituteErrors + i - 1)));
+        _mm256_storeu_si256((__m256i*)(row + i), _mm256_min_epi32(del, sub));
+    }
+    baseErrorsScalar(in, row, baseErrorsSSE41(in, row, i));
+    addTranspositions(in, row);
+
+    // Shifts only work within 128 bit lanes, so the low lane's
+    // minimum is carried over to the high lane separately.
+    __m256i offsets = _mm256_setr_epi32(ins, 2*ins, 3*ins, 4*ins, 5*ins, 6*ins, 7*ins, 8*ins);
+    int carry = row[0];
+    for(i=1; i+8 <= n+1; i+=8) {
+        __m256i x = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(row + i)), offsets);
+        x = _mm256_min_epi32(x, _mm256_alignr_epi8(x, inf, 12));
+        x = _mm256_min_epi32(x, _mm256_alignr_epi8(x, inf, 8));
+        x = _mm256_min_epi32(x, _mm256_blend_epi32(inf,
+                _mm256_permutevar8x32_epi32(x, lastOfLowLane), 0xF0));
+        x = _mm256_min_epi32(x, _mm256_set1_epi32(carry));
+        carry = _mm256_extract_epi32(x, 7);
+        _mm256_storeu_si256((__m256i*)(row + i), _mm256_add_epi32(x, offsets));
+        offsets = _mm256_add_epi32(offsets, step);
+    }
+    insertionScanScalar(in, row, insertionScanSSE41(in, row, i));
+}
+
+static TARGET_AVX2 bool gatherAVX2(const int *lutRow, const size_t lutLetters,
+        const Letter *query, const size_t length, int *errors) {
+    const __m256i limit = _mm256_set1_epi32(lutLetters-1);
+    size_t i = 0;
+    for(; i+8 <= length; i+=8) {
+        __m256i indexes;
+        if(sizeof(Letter) == 2) {
+            indexes = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(query + i)));
+        } else {
+            indexes = _mm256_loadu_si256((const __m256i*)(query + i));
+        }
+        // Unsigned comparison done as signed, letters never reach the sign bit.
+        if(_mm256_movemask_epi8(_mm256_cmpgt_epi32(indexes, limit)) != 0)
+            return false;
+        _mm256_storeu_si256((__m256i*)(errors + i), _mm256_i32gather_epi32(lutRow, indexes, 4));
+    }
+    return gatherScalar(lutRow, lutLetters, query + i, length - i, errors + i);
+}
+
+#endif
+
+ErrorRowFunction getErrorRowFunction(const RowKernelType type) {
+    switch(type) {
+    case SCALAR_ROW_KERNEL:
+        return errorRowScalar;
+#ifdef ROW_KERNEL_X86
+    case SSE41_ROW_KERNEL:
+        return __builtin_cpu_supports("sse4.1") ? errorRowSSE41 : nullptr;
+    case AVX2_ROW_KERNEL:
+        return __builtin_cpu_supports("avx2") ? errorRowAVX2 : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+SubstituteGatherFunction getSubstituteGatherFunction(const RowKernelType type) {
+    switch(type) {
+    case SCALAR_ROW_KERNEL:
+    case SSE41_ROW_KERNEL: // There is no gather instruction before AVX2.
+        return getErrorRowFunction(type) ? gatherScalar : nullptr;
+#ifdef ROW_KERNEL_X86
+    case AVX2_ROW_KERNEL:
+        return __builtin_cpu_supports("avx2") ? gatherAVX2 : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+RowKernelType bestRowKernel() {
+    static const RowKernelType best = getErrorRowFunction(AVX2_ROW_KERNEL) ? AVX2_ROW_KERNEL :
+            getErrorRowFunction(SSE41_ROW_KERNEL) ? SSE41_ROW_KERNEL : SCALAR_ROW_KERNEL;
+    return best;
+}
+
+void evaluateErrorRow(const ErrorRowInput &in, int *row) {
+    static const ErrorRowFunction f = getErrorRowFunction(bestRowKernel());
+    f(in, row);
+}
+
+bool gatherSubstituteErrors(const int *lutRow, const size_t lutLetters,
+        const Letter *query, const size_t length, int *errors) {
+    static const SubstituteGatherFunction f = getSubstituteGatherFunction(bestRowKernel());
+    return f(lutRow, lutLetters, query, length, errors);
+}
+
+COL_NAMESPACE_END
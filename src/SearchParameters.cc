@@ -30,11 +30,17 @@ struct SearchParametersPrivate {
     bool dynamic;
     ResultFilter filter;
     set<Word> nosearchFields;
+    size_t maxResults;
+    bool lastWordPrefix;
+    QueryStats *stats;
 };
 
 SearchParameters::SearchParameters() {
     p = new SearchParametersPrivate();
     p->dynamic = true;
+    p->maxResults = 0;
+    p->lastWordPrefix = false;
+    p->stats = nullptr;
 }
 
 SearchParameters::~SearchParameters() {
@@ -82,5 +88,29 @@ int SearchParameters::looseningIterations() const {
     return 1;
 }
 
+void SearchParameters::setMaxResults(size_t maxResults) {
+    p->maxResults = maxResults;
+}
+
+size_t SearchParameters::getMaxResults() const {
+    return p->maxResults;
+}
+
+void SearchParameters::setLastWordPrefix(bool prefix) {
+    p->lastWordPrefix = prefix;
+}
+
+bool SearchParameters::isLastWordPrefix() const {
+    return p->lastWordPrefix;
+}
+
+void SearchParameters::setQueryStats(QueryStats *stats) {
+    p->stats = stats;
+}
+
+QueryStats* SearchParameters::getQueryStats() const {
+    return p->stats;
+}
+
 COL_NAMESPACE_END
 
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SnapshotFile.hh"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+COL_NAMESPACE_START
+using namespace std;
+
+static const char snapshotMagic[8] = {'C', 'O', 'L', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t SNAPSHOT_FORMAT_VERSION = 3;
+static const uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+static const size_t SNAPSHOT_ALIGNMENT = 8;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    char type[16];
+};
+
+static size_t padding(const size_t bytes) {
+    return (SNAPSHOT_ALIGNMENT - bytes % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT;
+}
+
+static void throwFileError(const char *what, const string &path) {
+    string err(what);
+    err += path;
+    err += ": ";
+    err += strerror(errno);
+    throw runtime_error(err);
+}
+
+struct SnapshotWriterPrivate {
+    FILE *f;
+    string path;
+    string tmpPath;
+};
+
+SnapshotWriter::SnapshotWriter(const std::string &path, const char *type) {
+    SnapshotHeader h;
+    p = new SnapshotWriterPrivate();
+    p->path = path;
+    p->tmpPath = path + ".tmp";
+    p->f = fopen(p->tmpPath.c_str(), "wb");
+    if(!p->f) {
+        delete p;
+        throwFileError("Could not open snapshot file ", path);
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, snapshotMagic, sizeof(snapshotMagic));
+    h.version = SNAPSHOT_FORMAT_VERSION;
+    h.byteOrder = SNAPSHOT_BYTE_ORDER_MARK;
+    strncpy(h.type, type, sizeof(h.type)-1);
+    if(fwrite(&h, sizeof(h), 1, p->f) != 1) {
+        fclose(p->f);
+        unlink(p->tmpPath.c_str());
+        delete p;
+        throwFileError("Could not write snapshot file ", path);
+    }
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if(p->f) {
+        fclose(p->f);
+        unlink(p->tmpPath.c_str());
+    }
+    delete p;
+}
+
+void SnapshotWriter::writeBlock(const void *data, const size_t bytes) {
+    static const char zeros[SNAPSHOT_ALIGNMENT] = {0};
+    if(!p->f)
+        throw logic_error("Tried to write to a finished snapshot file.");
+    uint64_t size = bytes;
+    bool ok = fwrite(&size, sizeof(size), 1, p->f) == 1;
+    if(ok && bytes > 0)
+        ok = fwrite(data, bytes, 1, p->f) == 1;
+    if(ok && padding(bytes) > 0)
+        ok = fwrite(zeros, padding(bytes), 1, p->f) == 1;
+    if(!ok)
+        throwFileError("Could not write snapshot file ", p->path);
+}
+
+void SnapshotWriter::writeValue(const uint64_t value) {
+    writeBlock(&value, sizeof(value));
+}
+
+void SnapshotWriter::finish() {
+    FILE *f = p->f;
+    if(!f)
+        throw logic_error("Tried to finish a snapshot file twice.");
+    p->f = nullptr;
+    if(fflush(f) != 0 || fsync(fileno(f)) != 0) {
+        fclose(f);
+        unlink(p->tmpPath.c_str());
+        throwFileError("Could not write snapshot file ", p->path);
+    }
+    if(fclose(f) != 0) {
+        unlink(p->tmpPath.c_str());
+        throwFileError("Could not write snapshot file ", p->path);
+    }
+    if(rename(p->tmpPath.c_str(), p->path.c_str()) != 0) {
+        unlink(p->tmpPath.c_str());
+        throwFileError("Could not rename snapshot file ", p->path);
+    }
+}
+
+struct SnapshotReaderPrivate {
+    const char *map;
+    size_t size;
+    size_t pos;
+    string path;
+};
+
+SnapshotReader::SnapshotReader(const std::string &path, const char *type) {
+    struct stat st;
+    const SnapshotHeader *h;
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throwFileError("Could not open snapshot file ", path);
+    }
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        throw runtime_error(string("File ") + path + " is not a Columbus snapshot file.");
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        throwFileError("Could not map snapshot file ", path);
+    }
+    p = new SnapshotReaderPrivate();
+    p->map = (const char*)map;
+    p->size = st.st_size;
+    p->pos = sizeof(SnapshotHeader);
+    p->path = path;
+    h = (const SnapshotHeader*)p->map;
+    string err;
+    if(memcmp(h->magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+            strncmp(h->type, type, sizeof(h->type)) != 0) {
+        err = " is not a Columbus snapshot file of the correct type.";
+    } else if(h->byteOrder != SNAPSHOT_BYTE_ORDER_MARK) {
+        err = " was written on a machine with different endianness.";
+    } else if(h->version != SNAPSHOT_FORMAT_VERSION) {
+        err = " has an unsupported format version.";
+    }
+    if(!err.empty()) {
+        munmap((void*)p->map, p->size);
+        delete p;
+        throw runtime_error(string("File ") + path + err);
+    }
+    if(madvise((void*)p->map, p->size, MADV_SEQUENTIAL) != 0) {
+        fprintf(stderr, "Problem with madvise: %s\n", strerror(errno));
+    }
+}
+
+SnapshotReader::~SnapshotReader() {
+    munmap((void*)p->map, p->size);
+    delete p;
+}
+
+const void* SnapshotReader::readBlock(size_t &count, const size_t elementSize) {
+    uint64_t size;
+    if(p->pos + sizeof(size) > p->size) {
+        throw runtime_error(string("Snapshot file ") + p->path + " is truncated.");
+    }
+    memcpy(&size, p->map + p->pos, sizeof(size));
+    p->pos += sizeof(size);
+    if(size > p->size - p->pos || size % elementSize != 0) {
+        throw runtime_error(string("Snapshot file ") + p->path + " is corrupt.");
+    }
+    const void *data = p->map + p->pos;
+    p->pos += size + padding(size);
+    count = size / elementSize;
+    return data;
+}
+
+uint64_t SnapshotReader::readValue() {
+    size_t count;
+    const uint64_t *value = readArray<uint64_t>(count);
+    if(count != 1) {
+        throw runtime_error(string("Snapshot file ") + p->path + " is corrupt.");
+    }
+    return *value;
+}
+
+COL_NAMESPACE_END
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.hh"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include <list>
+
+COL_NAMESPACE_START
+using namespace std;
+
+/*
+ * One call to run(). Tasks are handed out in increasing order under
+ * the pool lock. The job stays in the pool's list until every handed out
+ * task has finished and run() removes it.
+ */
+struct ThreadJob {
+    ThreadTask *task;
+    size_t numTasks;
+    size_t nextTask;
+    size_t running;
+    exception_ptr error;
+    condition_variable done;
+};
+
+struct ThreadPoolPrivate {
+    vector<thread> threads;
+    list<ThreadJob*> jobs;
+    mutex lock;
+    condition_variable workAvailable;
+    bool quitting;
+};
+
+ThreadPool::ThreadPool(const size_t numThreads) {
+    if(numThreads == 0) {
+        throw invalid_argument("Thread pool must have at least one thread.");
+    }
+    p = new ThreadPoolPrivate();
+    p->quitting = false;
+    try {
+        for(size_t i=0; i<numThreads-1; i++) {
+            p->threads.push_back(thread(&ThreadPool::workerLoop, this, i));
+        }
+    } catch(...) {
+        {
+            lock_guard<mutex> l(p->lock);
+            p->quitting = true;
+        }
+        p->workAvailable.notify_all();
+        for(auto &t : p->threads)
+            t.join();
+        delete p;
+        throw;
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> l(p->lock);
+        p->quitting = true;
+    }
+    p->workAvailable.notify_all();
+    for(auto &t : p->threads)
+        t.join();
+    delete p;
+}
+
+size_t ThreadPool::size() const {
+    return p->threads.size() + 1;
+}
+
+/*
+ * Runs tasks of the given job until none are left. Must be called
+ * with the lock held. The lock is released while a task executes.
+ */
+static void executeTasks(ThreadJob *job, const size_t worker, unique_lock<mutex> &l) {
+    while(job->nextTask < job->numTasks) {
+        const size_t task = job->nextTask++;
+        job->running++;
+        l.unlock();
+        exception_ptr error;
+        try {
+            job->task->execute(task, worker);
+        } catch(...) {
+            error = current_exception();
+        }
+        l.lock();
+        job->running--;
+        if(error) {
+            if(!job->error)
+                job->error = error;
+            job->nextTask = job->numTasks;
+        }
+    }
+    if(job->running == 0)
+        job->done.notify_all();
+}
+
+static ThreadJob* findJob(ThreadPoolPrivate *p) {
+    for(auto job : p->jobs) {
+        if(job->nextTask < job->numTasks)
+            return job;
+    }
+    return nullptr;
+}
+
+void ThreadPool::workerLoop(const size_t worker) {
+    unique_lock<mutex> l(p->lock);
+    while(true) {
+        ThreadJob *job;
+        while(!p->quitting && (job = findJob(p)) == nullptr)
+            p->workAvailable.wait(l);
+        if(p->quitting)
+            return;
+        executeTasks(job, worker, l);
+    }
+}
+
+void ThreadPool::run(ThreadTask &task, const size_t numTasks) {
+    ThreadJob job;
+    job.task = &task;
+    job.numTasks = numTasks;
+    job.nextTask = 0;
+    job.running = 0;
+    unique_lock<mutex> l(p->lock);
+    if(numTasks > 1 && !p->threads.empty()) {
+        p->jobs.push_back(&job);
+        p->workAvailable.notify_all();
+    }
+    // The caller gets the last worker number, pool threads have the others.
+    executeTasks(&job, p->threads.size(), l);
+    while(job.running > 0)
+        job.done.wait(l);
+    p->jobs.remove(&job);
+    if(job.error)
+        rethrow_exception(job.error);
+}
+
+COL_NAMESPACE_END
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Tokenizer.hh"
+#include "ColumbusHelpers.hh"
+#include "Word.hh"
+#include "WordList.hh"
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+COL_NAMESPACE_START
+using namespace std;
+
+struct TokenizerPrivate {
+    vector<Letter> letters;
+    vector<TokenSpan> tokens;
+};
+
+static bool isInList(const Letter l, const Letter *chars, int numChars) {
+    for(int i=0; i<numChars;i++)
+        if(chars[i] == l)
+            return true;
+    return false;
+}
+
+Tokenizer::Tokenizer() {
+    p = new TokenizerPrivate();
+}
+
+Tokenizer::~Tokenizer() {
+    delete p;
+}
+
+static unsigned int decode(TokenizerPrivate *p, const char *utf8Text) {
+    size_t bytes = strlen(utf8Text);
+    p->tokens.clear();
+    p->letters.resize(bytes+1);
+    return utf8ToInternal(utf8Text, bytes, &p->letters[0]);
+}
+
+template<typename SplitTest>
+static void findTokens(TokenizerPrivate *p, const unsigned int numLetters, SplitTest isSplit) {
+    const Letter *text = &p->letters[0];
+    unsigned int i = 0;
+    while(i < numLetters) {
+        while(i < numLetters && isSplit(text[i]))
+            i++;
+        if(i >= numLetters)
+            break;
+        TokenSpan span;
+        span.offset = i;
+        while(i < numLetters && !isSplit(text[i]))
+            i++;
+        span.length = i - span.offset;
+        p->tokens.push_back(span);
+    }
+}
+
+void Tokenizer::tokenize(const char *utf8Text) {
+    findTokens(p, decode(p, utf8Text), isWhitespace);
+}
+
+void Tokenizer::tokenize(const char *utf8Text, const Letter *splitChars, int numChars) {
+    findTokens(p, decode(p, utf8Text), [splitChars, numChars](const Letter l) {
+        return isInList(l, splitChars, numChars);
+    });
+}
+
+size_t Tokenizer::size() const {
+    return p->tokens.size();
+}
+
+const TokenSpan& Tokenizer::operator[](const size_t i) const {
+    if(i >= p->tokens.size())
+        throw out_of_range("Out of bounds access in Tokenizer.");
+    return p->tokens[i];
+}
+
+const Letter* Tokenizer::letters() const {
+    return p->letters.data();
+}
+
+Word Tokenizer::word(const size_t i) const {
+    const TokenSpan &span = (*this)[i];
+    return Word(letters() + span.offset, span.length);
+}
+
+void Tokenizer::appendTo(WordList &list) const {
+    for(size_t i=0; i<p->tokens.size(); i++) {
+        list.addWord(word(i));
+    }
+}
+
+COL_NAMESPACE_END
@@ -20,19 +20,49 @@
 /*
  * This class implements a trie as an array. It uses a sparse memory mapped
  * file for backing storage. This makes it possible to grow the allocation
- * efficiently with ftruncate.
+ * efficiently with ftruncate. On Linux the mapping is then extended in
+ * place with mremap, so the pages already faulted in stay where they are.
+ * Elsewhere the whole file has to be unmapped and mapped again.
  *
- * The offsets have 32 bits to save memory. 4 gigs of trie should be enough
- * for everybody.
+ * Because everything is addressed with offsets, the array can be written
+ * to disk as is and mapped back in read-only by another process.
+ *
+ * The offsets have 32 bits to save memory, which limits a trie to 4 gigs.
+ * Building with large_tries makes them 64 bits wide. The nodes then take
+ * about half again as much space. The width is stored in the header and
+ * files written with the other width are refused.
  *
  * This low level bit fiddling makes the code slightly hard to read. It
  * should still be understandable, though.
+ *
+ * Nodes are appended as they are created, so the children of a node end
+ * up scattered all over the file. Once building is done freeze() rewrites
+ * the trie in breadth first order. Every node is then directly followed by
+ * its children, sorted by letter, so they can be binary searched and a
+ * node's subtree is read with far fewer cache misses. The sibling pointers
+ * are kept so frozen tries are traversed with the same calls as before.
+ *
+ * makeSuccinct() goes further and replaces the nodes with a LOUDS encoding
+ * of the tree shape. Listing the nodes in breadth first order, every node
+ * is written as a one bit for each of its children followed by a zero.
+ * The k:th one bit is then the edge to node k+1, so moving around is done
+ * with rank and select instead of pointers. The other data are a bit per
+ * node telling whether it ends a word, the letter of every edge and the
+ * IDs of the words. That takes a few bytes per node instead of 32.
+ *
+ * A succinct trie uses different handles. Nodes are numbered in breadth
+ * first order starting from 1 and siblings are their LOUDS bit position
+ * plus one. Zero still means none. Adding words turns a succinct trie back
+ * into a frozen one first.
  */
 
 #include"Trie.hh"
 #include"Word.hh"
+#include"BitVector.hh"
 #include<sys/mman.h>
+#include<sys/stat.h>
 #include<unistd.h>
+#include<fcntl.h>
 #include<sys/types.h>
 #include<stdio.h>
 #include<errno.h>
@@ -40,19 +70,45 @@
 #include<stdexcept>
 #include<string>
 #include<vector>
+#include<algorithm>
 #include<cassert>
 
 using namespace std;
 
 COL_NAMESPACE_START
 
+/*
+ * The header is the first thing in the backing file. The fields before
+ * totalSize make it possible to store a trie on disk and map it back in
+ * a later process. They are checked before a file is accepted so we
+ * never interpret an incompatible image as valid data.
+ */
+
+static const char trieMagic[8] = {'C', 'O', 'L', 'T', 'R', 'I', 'E', '\0'};
+static const uint32_t TRIE_FORMAT_VERSION = 2;
+static const uint32_t TRIE_BYTE_ORDER_MARK = 0x01020304;
+
+static const uint32_t TRIE_FROZEN = 1;
+static const uint32_t TRIE_SUCCINCT = 2;
+
 struct TrieHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t letterSize;
+    uint32_t offsetSize;
     TrieOffset totalSize;
     TrieOffset firstFree;
-    uint32_t numWords;
-    uint32_t numNodes;
+    TrieOffset numWords;
+    TrieOffset numNodes;
+    uint32_t flags;
 };
 
+/*
+ * Every node has a TriePtrs after it whose sibling field points to the
+ * first real child entry. In a frozen trie its child field holds the
+ * number of children, which follow it contiguously.
+ */
 struct TriePtrs {
     Letter l;
     TrieOffset child;
@@ -64,66 +120,556 @@ struct TrieNode {
     TrieOffset parent;
 };
 
+/*
+ * Where the parts of a succinct trie are, as offsets from the start of
+ * the file. It comes right after TrieHeader.
+ */
+struct SuccinctTrieHeader {
+    uint64_t louds;
+    uint64_t terminals;
+    uint64_t letters;
+    uint64_t words;
+};
+
+static const size_t SUCCINCT_HEADER_START = (sizeof(TrieHeader) + 7) / 8 * 8;
+
+/*
+ * Nodes in breadth first order with children sorted by letter. This is
+ * what freeze() and makeSuccinct() are written from.
+ */
+struct TrieLayout {
+    vector<WordID> words;
+    vector<Letter> letters;       // The letter leading to each node.
+    vector<size_t> parents;
+    vector<size_t> firstChildren; // One extra at the end.
+};
+
 struct TriePrivate {
-    FILE *f;
+    int fd; // Backing file of a writable trie, -1 if there is none.
     char *map;
+    size_t mapSize;
+    bool readOnly; // Mapped from a file written by save().
     TrieHeader *h;
     TrieOffset root;
+    bool succinct;
+    BitVector louds;
+    BitVector terminals;
+    const Letter *letters;
+    const WordID *words;
 };
 
-Trie::Trie() {
-    p = new TriePrivate();
-    p->f = tmpfile();
-    if(!p->f) {
+static int createBackingFile() {
+    FILE *f = tmpfile();
+    if(!f) {
         string msg("Could not create temporary file: ");
         msg += strerror(errno);
         throw runtime_error(msg);
     }
+    // The duplicate keeps the unlinked file alive after the stream is gone.
+    const int fd = dup(fileno(f));
+    const int error = errno;
+    fclose(f);
+    if(fd < 0) {
+        string msg("Could not create temporary file: ");
+        msg += strerror(error);
+        throw runtime_error(msg);
+    }
+    return fd;
+}
+
+static void unmap(TriePrivate *p) {
+    if(p->map && munmap(p->map, p->mapSize) != 0) {
+        fprintf(stderr, "Munmap failed: %s\n", strerror(errno));
+    }
     p->map = nullptr;
+    p->h = nullptr;
+    p->mapSize = 0;
+}
+
+Trie::Trie() {
+    p = new TriePrivate();
+    p->fd = createBackingFile();
+    p->map = nullptr;
+    p->mapSize = 0;
+    p->readOnly = false;
+    p->succinct = false;
     expand();
+    memcpy(p->h->magic, trieMagic, sizeof(trieMagic));
+    p->h->version = TRIE_FORMAT_VERSION;
+    p->h->byteOrder = TRIE_BYTE_ORDER_MARK;
+    p->h->letterSize = sizeof(Letter);
+    p->h->offsetSize = sizeof(TrieOffset);
     p->h->firstFree = sizeof(TrieHeader);
     p->root = p->h->firstFree;
     p->h->numWords = 0;
+    p->h->flags = 0;
     addNewNode(0);
 }
 
 
 Trie::~Trie() {
-    fclose(p->f);
+    unmap(p);
+    if(p->fd >= 0)
+        close(p->fd);
     delete p;
 }
 
+/*
+ * Access pattern hints. Maps that are being written from start to end
+ * are sequential, tries that are done and only searched are random.
+ * Tries that are growing get the default, because new nodes are
+ * appended in order but lookups jump around.
+ */
+static void adviseMap(char *map, const size_t size, const int advice) {
+    if(madvise(map, size, advice) != 0) {
+        fprintf(stderr, "Problem with madvise: %s\n", strerror(errno));
+    }
+}
+
 void Trie::expand() {
     TrieOffset newSize;
     if(p->map) {
         TrieOffset oldSize = p->h->totalSize;
         newSize = oldSize*2;
-        if(munmap(p->map, oldSize) != 0) {
+        if(newSize < oldSize)
+            throw overflow_error("Trie does not fit in the offset size.");
+    } else {
+        newSize = 1024;
+    }
+    if(ftruncate(p->fd, newSize) != 0) {
+        string err = "Truncate failed: ";
+        err += strerror(errno);
+        throw runtime_error(err);
+    }
+    char *newMap;
+#ifdef __linux__
+    if(p->map) {
+        newMap = (char*)mremap(p->map, p->mapSize, newSize, MREMAP_MAYMOVE);
+        if(newMap == MAP_FAILED) {
+            string err = "MRemap failed: ";
+            err += strerror(errno);
+            throw runtime_error(err);
+        }
+    } else
+#endif
+    {
+        if(p->map && munmap(p->map, p->mapSize) != 0) {
             string err = "Munmap failed: ";
             err += strerror(errno);
             throw runtime_error(err);
         }
-    } else {
-        newSize = 1024;
+        p->map = nullptr;
+        newMap = (char*)mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                p->fd, 0);
+        if(newMap == MAP_FAILED) {
+            string err = "MMap failed: ";
+            err += strerror(errno);
+            throw runtime_error(err);
+        }
+    }
+    adviseMap(newMap, newSize, MADV_NORMAL);
+    p->map = newMap;
+    p->mapSize = newSize;
+    p->h = (TrieHeader*)p->map;
+    p->h->totalSize = newSize;
+    assert(p->h->totalSize > p->h->firstFree);
+}
+
+/*
+ * Creates a new writable backing file that can hold at least minSize bytes.
+ * The size is rounded up the same way expand() grows it.
+ */
+static char* createPrivateMap(const TrieOffset minSize, int &fd, TrieOffset &newSize) {
+    newSize = 1024;
+    while(newSize <= minSize) {
+        if(newSize*2 < newSize)
+            throw overflow_error("Trie does not fit in the offset size.");
+        newSize *= 2;
     }
-    if(ftruncate(fileno(p->f), newSize) != 0) {
+    fd = createBackingFile();
+    if(ftruncate(fd, newSize) != 0) {
         string err = "Truncate failed: ";
         err += strerror(errno);
+        close(fd);
         throw runtime_error(err);
     }
-    p->map = (char*)mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED,
-                  fileno(p->f), 0);
-    if(p->map == MAP_FAILED) {
+    char *newMap = (char*)mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    if(newMap == MAP_FAILED) {
         string err = "MMap failed: ";
         err += strerror(errno);
+        close(fd);
         throw runtime_error(err);
     }
-    if(madvise(p->map, newSize, MADV_RANDOM | MADV_WILLNEED) != 0) {
-        fprintf(stderr, "Problem with madvise: %s\n", strerror(errno));
+    adviseMap(newMap, newSize, MADV_SEQUENTIAL);
+    return newMap;
+}
+
+/*
+ * Points the succinct trie accessors to the current map. Throws if the
+ * parts do not fit in the used area.
+ */
+static void attachSuccinct(TriePrivate *p) {
+    p->succinct = (p->h->flags & TRIE_SUCCINCT) != 0;
+    if(!p->succinct) {
+        p->root = sizeof(TrieHeader);
+        return;
     }
+    SuccinctTrieHeader sh;
+    const size_t used = p->h->firstFree;
+    if(used < SUCCINCT_HEADER_START + sizeof(sh))
+        throw runtime_error("Succinct trie is truncated.");
+    memcpy(&sh, p->map + SUCCINCT_HEADER_START, sizeof(sh));
+    if(sh.louds > used || sh.terminals > used || sh.letters > used || sh.words > used)
+        throw runtime_error("Succinct trie is truncated.");
+    p->louds.attach(p->map + sh.louds, used - sh.louds);
+    p->terminals.attach(p->map + sh.terminals, used - sh.terminals);
+    if(p->louds.ones()+1 != p->h->numNodes || p->terminals.size() != p->h->numNodes ||
+            p->terminals.ones() != p->h->numWords ||
+            sh.letters + p->louds.ones()*sizeof(Letter) > used ||
+            sh.words + p->terminals.ones()*sizeof(WordID) > used)
+        throw runtime_error("Succinct trie is corrupt.");
+    p->letters = (const Letter*)(p->map + sh.letters);
+    p->words = (const WordID*)(p->map + sh.words);
+    p->root = 1;
+}
+
+static void replaceMap(TriePrivate *p, const int fd, char *newMap, const TrieOffset newSize) {
+    unmap(p);
+    if(p->fd >= 0)
+        close(p->fd);
+    p->fd = fd;
+    p->map = newMap;
+    p->mapSize = newSize;
+    p->readOnly = false;
     p->h = (TrieHeader*)p->map;
     p->h->totalSize = newSize;
-    assert(p->h->totalSize > p->h->firstFree);
+    attachSuccinct(p);
+}
+
+/*
+ * A trie that was opened with openReadOnly can still be modified. The
+ * first modification copies the image into a private temporary file so
+ * the file on disk is never touched. Succinct tries are expanded into
+ * frozen ones instead.
+ */
+void Trie::makeWritable() {
+    if(p->succinct) {
+        TrieLayout layout;
+        collectLayout(layout);
+        writeFrozen(layout);
+        return;
+    }
+    if(!p->readOnly)
+        return;
+    TrieOffset used = p->h->firstFree;
+    int fd;
+    TrieOffset newSize;
+    char *newMap = createPrivateMap(used, fd, newSize);
+    memcpy(newMap, p->map, used);
+    replaceMap(p, fd, newMap, newSize);
+    adviseMap(p->map, p->mapSize, MADV_NORMAL);
+}
+
+void Trie::collectLayout(TrieLayout &layout) const {
+    vector<TrieOffset> order;
+    vector<pair<Letter, TrieOffset> > children;
+    order.push_back(getRoot());
+    layout.letters.push_back(0);
+    layout.parents.push_back(0);
+    for(size_t i=0; i<order.size(); i++) {
+        children.clear();
+        for(TrieOffset sibl = getSiblingList(order[i]); sibl; sibl = getNextSibling(sibl))
+            children.push_back(make_pair(getLetter(sibl), getChild(sibl)));
+        sort(children.begin(), children.end());
+        layout.words.push_back(getWordID(order[i]));
+        layout.firstChildren.push_back(order.size());
+        for(const auto &c : children) {
+            order.push_back(c.second);
+            layout.letters.push_back(c.first);
+            layout.parents.push_back(i);
+        }
+    }
+    layout.firstChildren.push_back(order.size());
+}
+
+/*
+ * Every node gets its place first so the pointers can be filled in
+ * with the new offsets as the nodes are written.
+ */
+void Trie::writeFrozen(const TrieLayout &layout) {
+    const size_t numNodes = layout.words.size();
+    vector<TrieOffset> offsets(numNodes);
+    uint64_t pos = sizeof(TrieHeader);
+    for(size_t i=0; i<numNodes; i++) {
+        offsets[i] = pos;
+        pos += sizeof(TrieNode) + (layout.firstChildren[i+1] - layout.firstChildren[i] + 1)*sizeof(TriePtrs);
+    }
+    if(pos != (TrieOffset)pos)
+        throw overflow_error("Trie does not fit in the offset size.");
+
+    int fd;
+    TrieOffset newSize;
+    char *newMap = createPrivateMap(pos, fd, newSize);
+    TrieHeader *h = (TrieHeader*)newMap;
+    *h = *p->h;
+    h->firstFree = pos;
+    h->flags = TRIE_FROZEN;
+    for(size_t i=0; i<numNodes; i++) {
+        TrieNode *n = (TrieNode*)(newMap + offsets[i]);
+        TriePtrs *ptrs = (TriePtrs*)(newMap + offsets[i] + sizeof(TrieNode));
+        const size_t numChildren = layout.firstChildren[i+1] - layout.firstChildren[i];
+        n->word = layout.words[i];
+        n->parent = i == 0 ? 0 : offsets[layout.parents[i]];
+        ptrs->l = 0;
+        ptrs->child = numChildren;
+        ptrs->sibling = numChildren == 0 ? 0 : offsets[i] + sizeof(TrieNode) + sizeof(TriePtrs);
+        for(size_t j=0; j<numChildren; j++) {
+            const size_t child = layout.firstChildren[i] + j;
+            ptrs++;
+            ptrs->l = layout.letters[child];
+            ptrs->child = offsets[child];
+            ptrs->sibling = j+1 == numChildren ? 0 : (TrieOffset)((char*)(ptrs+1) - newMap);
+        }
+    }
+    replaceMap(p, fd, newMap, newSize);
+    adviseMap(p->map, p->mapSize, MADV_RANDOM);
+}
+
+static size_t padTo8(const size_t bytes) {
+    return (bytes + 7) / 8 * 8;
+}
+
+static void setBit(vector<uint64_t> &bits, const size_t i) {
+    bits[i/64] |= ((uint64_t)1) << (i%64);
+}
+
+void Trie::writeSuccinct(const TrieLayout &layout) {
+    const size_t numNodes = layout.words.size();
+    // Every node but the root is a one and every node ends with a zero.
+    const size_t numLoudsBits = 2*numNodes - 1;
+    vector<uint64_t> loudsBits((numLoudsBits + 63) / 64, 0);
+    vector<uint64_t> terminalBits((numNodes + 63) / 64, 0);
+    vector<WordID> words;
+    SuccinctTrieHeader sh;
+
+    size_t pos = 0;
+    for(size_t i=0; i<numNodes; i++) {
+        for(size_t j=layout.firstChildren[i]; j<layout.firstChildren[i+1]; j++)
+            setBit(loudsBits, pos++);
+        pos++;
+        if(layout.words[i] != INVALID_WORDID) {
+            setBit(terminalBits, i);
+            words.push_back(layout.words[i]);
+        }
+    }
+    sh.louds = SUCCINCT_HEADER_START + sizeof(SuccinctTrieHeader);
+    sh.terminals = sh.louds + BitVector::imageSize(numLoudsBits, numNodes - 1);
+    sh.letters = sh.terminals + BitVector::imageSize(numNodes, words.size());
+    sh.words = sh.letters + padTo8((numNodes-1)*sizeof(Letter));
+    const TrieOffset end = sh.words + padTo8(words.size()*sizeof(WordID));
+    if(end < sh.words)
+        throw overflow_error("Succinct trie does not fit in the offset size.");
+
+    int fd;
+    TrieOffset newSize;
+    char *newMap = createPrivateMap(end, fd, newSize);
+    TrieHeader *h = (TrieHeader*)newMap;
+    *h = *p->h;
+    h->firstFree = end;
+    h->flags = TRIE_FROZEN | TRIE_SUCCINCT;
+    memcpy(newMap + SUCCINCT_HEADER_START, &sh, sizeof(sh));
+    BitVector::build(loudsBits.data(), numLoudsBits, newMap + sh.louds);
+    BitVector::build(terminalBits.data(), numNodes, newMap + sh.terminals);
+    // The root has no letter.
+    memcpy(newMap + sh.letters, layout.letters.data() + 1, (numNodes-1)*sizeof(Letter));
+    memcpy(newMap + sh.words, words.data(), words.size()*sizeof(WordID));
+    replaceMap(p, fd, newMap, newSize);
+    adviseMap(p->map, p->mapSize, MADV_RANDOM);
+}
+
+void Trie::freeze() {
+    if(isFrozen())
+        return;
+    TrieLayout layout;
+    collectLayout(layout);
+    writeFrozen(layout);
+}
+
+void Trie::makeSuccinct() {
+    if(isSuccinct())
+        return;
+    TrieLayout layout;
+    collectLayout(layout);
+    writeSuccinct(layout);
+}
+
+bool Trie::isFrozen() const {
+    return p->h->flags & TRIE_FROZEN;
+}
+
+bool Trie::isSuccinct() const {
+    return p->succinct;
+}
+
+// Where the LOUDS bits of a succinct node begin.
+static size_t succinctBlock(const BitVector &louds, const TrieOffset node) {
+    return node == 1 ? 0 : louds.select0(node-2) + 1;
+}
+
+/*
+ * Returns the sibling entry of node that leads to letter l or 0 if there
+ * is none.
+ */
+TrieOffset Trie::findSibling(const TrieOffset node, const Letter l) const {
+    if(p->succinct) {
+        const size_t block = succinctBlock(p->louds, node);
+        const size_t end = p->louds.select0(node-1);
+        const size_t firstEdge = p->louds.rank1(block);
+        const Letter *first = p->letters + firstEdge;
+        const Letter *last = first + (end - block);
+        const Letter *found = lower_bound(first, last, l);
+        if(found == last || *found != l)
+            return 0;
+        return block + (found - first) + 1;
+    }
+    const TriePtrs *head = (const TriePtrs*)(p->map + node + sizeof(TrieNode));
+    if(isFrozen()) {
+        const TriePtrs *first = head + 1;
+        const TriePtrs *last = first + head->child;
+        const TriePtrs *found = lower_bound(first, last, l,
+                [](const TriePtrs &ptrs, const Letter letter) { return ptrs.l < letter; });
+        if(found == last || found->l != l)
+            return 0;
+        return (const char*)found - p->map;
+    }
+    TrieOffset sibl = head->sibling;
+    while(sibl != 0) {
+        const TriePtrs *ptrs = (const TriePtrs*)(p->map + sibl);
+        if(ptrs->l == l)
+            return sibl;
+        sibl = ptrs->sibling;
+    }
+    return 0;
+}
+
+/*
+ * The image is written to a temporary file which then replaces the
+ * target. Truncating the target in place would pull the pages out from
+ * under any trie that has it mapped, this one included.
+ */
+void Trie::save(const char *path) const {
+    TrieHeader header = *p->h;
+    string tmpPath(path);
+    tmpPath += ".tmp";
+    FILE *out = fopen(tmpPath.c_str(), "wb");
+    if(!out) {
+        string err = "Could not open ";
+        err += tmpPath;
+        err += " for writing: ";
+        err += strerror(errno);
+        throw runtime_error(err);
+    }
+    // The image is exactly as big as its contents, there is no free space at the end.
+    header.totalSize = header.firstFree;
+    size_t dataSize = header.firstFree - sizeof(TrieHeader);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    if(ok && dataSize > 0)
+        ok = fwrite(p->map + sizeof(TrieHeader), dataSize, 1, out) == 1;
+    if(ok)
+        ok = fflush(out) == 0 && fsync(fileno(out)) == 0;
+    if(fclose(out) != 0)
+        ok = false;
+    if(ok && rename(tmpPath.c_str(), path) != 0)
+        ok = false;
+    if(!ok) {
+        string err = "Could not write trie to ";
+        err += path;
+        err += ": ";
+        err += strerror(errno);
+        unlink(tmpPath.c_str());
+        throw runtime_error(err);
+    }
+}
+
+static void validateHeader(const TrieHeader *h, const size_t fileSize, const char *path) {
+    string err;
+    if(fileSize < sizeof(TrieHeader) || memcmp(h->magic, trieMagic, sizeof(trieMagic)) != 0) {
+        err = "is not a trie file";
+    } else if(h->byteOrder != TRIE_BYTE_ORDER_MARK) {
+        err = "was written on a machine with different endianness";
+    } else if(h->version != TRIE_FORMAT_VERSION) {
+        err = "has an unsupported format version";
+    } else if(h->letterSize != sizeof(Letter)) {
+        err = "was written with a different letter size (full_unicode mismatch)";
+    } else if(h->offsetSize != sizeof(TrieOffset)) {
+        err = "was written with a different trie offset size";
+    } else if(h->firstFree > fileSize ||
+            h->firstFree < sizeof(TrieHeader) + sizeof(TrieNode) + sizeof(TriePtrs)) {
+        err = "is truncated";
+    }
+    if(!err.empty()) {
+        string msg("File ");
+        msg += path;
+        msg += " ";
+        msg += err;
+        msg += ".";
+        throw runtime_error(msg);
+    }
+}
+
+void Trie::openReadOnly(const char *path) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        string err = "Could not open ";
+        err += path;
+        err += ": ";
+        err += strerror(errno);
+        throw runtime_error(err);
+    }
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TrieHeader)) {
+        close(fd);
+        validateHeader(nullptr, 0, path);
+    }
+    char *newMap = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(newMap == MAP_FAILED) {
+        string err = "MMap failed: ";
+        err += strerror(errno);
+        throw runtime_error(err);
+    }
+    TriePrivate loaded(*p);
+    loaded.fd = -1;
+    loaded.map = newMap;
+    loaded.mapSize = st.st_size;
+    loaded.readOnly = true;
+    loaded.h = (TrieHeader*)newMap;
+    try {
+        validateHeader(loaded.h, st.st_size, path);
+    } catch(...) {
+        munmap(newMap, st.st_size);
+        throw;
+    }
+    try {
+        attachSuccinct(&loaded);
+    } catch(const runtime_error &e) {
+        munmap(newMap, st.st_size);
+        string msg("File ");
+        msg += path;
+        msg += ": ";
+        msg += e.what();
+        throw runtime_error(msg);
+    }
+    adviseMap(newMap, st.st_size, MADV_RANDOM);
+    unmap(p);
+    if(p->fd >= 0)
+        close(p->fd);
+    *p = loaded;
+}
+
+bool Trie::isReadOnly() const {
+    return p->readOnly;
 }
 
 TrieOffset Trie::append(const char *data, const int size) {
@@ -168,9 +714,11 @@ TrieOffset Trie::addNewSibling(const TrieOffset node, const TrieOffset sibling,
 
 TrieOffset Trie::insertWord(const Word &word, const WordID wordID) {
     size_t i=0;
-    TrieOffset node = p->root;
     Letter lw = word[0];
 
+    makeWritable();
+    TrieOffset node = p->root;
+
     // A word mustn't begin with a broken surrogate pair.
     if(lw.isSurrogate() && !lw.isHighSurrogate()) {
         assert(false);
@@ -178,20 +726,17 @@ TrieOffset Trie::insertWord(const Word &word, const WordID wordID) {
 
     while(word.length() > i) {
         Letter l = word[i];
-        TrieOffset searcher = node;
-        //TrieNode *n = (TrieNode*)(p->map + searcher);
-        TrieOffset sibl = searcher + sizeof(TrieNode);
-        TriePtrs *ptrs = (TriePtrs*)(p->map + sibl);
-
-        while(ptrs->sibling != 0 && ptrs->l != l) {
-            sibl = ptrs->sibling;
-            ptrs = (TriePtrs*)(p->map + sibl);
-        }
-
-        if(ptrs->l == l) {
-            node = ptrs->child;
+        TrieOffset sibl = findSibling(node, l);
+        if(sibl) {
+            node = getChild(sibl);
         } else {
+            // Find the end of the list, the new entry goes after it.
+            sibl = node + sizeof(TrieNode);
+            while(hasSibling(sibl))
+                sibl = getNextSibling(sibl);
             node = addNewSibling(node, sibl, l);
+            // The children of this node are no longer contiguous.
+            p->h->flags &= ~TRIE_FROZEN;
         }
         i++;
     }
@@ -213,27 +758,16 @@ bool Trie::hasWord(const Word &word) const {
     TrieOffset node = findWord(word);
     if(!node)
         return false;
-    TrieNode *n = (TrieNode*)(p->map+node);
-    if(n->word != INVALID_WORDID)
-        return true;
-    return false;
+    return getWordID(node) != INVALID_WORDID;
 }
 
 TrieOffset Trie::findWord(const Word &word) const {
     TrieOffset node = p->root;
     for(size_t i=0; word.length() > i; i++) {
-        Letter l = word[i];
-        TrieOffset searcher = node;
-        TrieOffset sibl = searcher + sizeof(TrieNode);
-        TriePtrs *ptrs = (TriePtrs*)(p->map + sibl);
-        while(ptrs->sibling != 0 && ptrs->l != l) {
-            sibl = ptrs->sibling;
-            ptrs = (TriePtrs*)(p->map + sibl);
-        }
-
-        if(ptrs->l != l)
+        TrieOffset sibl = findSibling(node, word[i]);
+        if(!sibl)
             return 0;
-        node = ptrs->child;
+        node = getChild(sibl);
     }
     return node;
 }
@@ -244,32 +778,49 @@ TrieOffset Trie::getRoot() const {
 
 
 TrieOffset Trie::getSiblingList(TrieOffset node) const {
+    if(p->succinct) {
+        const size_t block = succinctBlock(p->louds, node);
+        return p->louds.get(block) ? block+1 : 0;
+    }
     TriePtrs *ptrs = (TriePtrs*)(p->map + node + sizeof(TrieNode));
     return ptrs->sibling;
 
 }
 
 TrieOffset Trie::getNextSibling(TrieOffset sibling) const {
+    if(p->succinct)
+        return p->louds.get(sibling) ? sibling+1 : 0;
     TriePtrs *ptrs = (TriePtrs*)(p->map + sibling);
     return ptrs->sibling;
 }
 
 Letter Trie::getLetter(TrieOffset sibling) const {
+    if(p->succinct)
+        return p->letters[p->louds.rank1(sibling-1)];
     TriePtrs *ptrs = (TriePtrs*)(p->map + sibling);
     return ptrs->l;
 }
 
 TrieOffset Trie::getChild(TrieOffset sibling) const {
+    if(p->succinct)
+        return p->louds.rank1(sibling-1) + 2;
     TriePtrs *ptrs = (TriePtrs*)(p->map + sibling);
     return ptrs->child;
 }
 
 WordID Trie::getWordID(TrieOffset node) const {
+    if(p->succinct) {
+        if(!p->terminals.get(node-1))
+            return INVALID_WORDID;
+        return p->words[p->terminals.rank1(node-1)];
+    }
     TrieNode *n = (TrieNode*)(p->map + node);
     return n->word;
 }
 
 bool Trie::hasSibling(TrieOffset sibling) const {
+    if(p->succinct)
+        return p->louds.get(sibling);
     TriePtrs *ptrs = (TriePtrs*)(p->map + sibling);
     return ptrs->sibling != 0;
 }
@@ -282,12 +833,39 @@ size_t Trie::numNodes() const {
     return p->h->numNodes;
 }
 
+size_t Trie::memoryUsage() const {
+    return p->mapSize;
+}
+
 TrieOffset Trie::getParent(TrieOffset node) const {
+    if(p->succinct) {
+        if(node == 1)
+            return 0;
+        // The zeros before the edge bit each end one node's children.
+        return p->louds.rank0(p->louds.select1(node-2)) + 1;
+    }
     TrieNode *n = (TrieNode*)(p->map + node);
     return n->parent;
 }
 
 TrieOffset Trie::getSiblingTo(const TrieOffset node, const TrieOffset child) const {
+    if(p->succinct) {
+        const TrieOffset sibling = p->louds.select1(child-2) + 1;
+        if(p->louds.rank0(sibling-1) + 1 != node)
+            throw runtime_error("Trie is corrupted");
+        return sibling;
+    }
+    if(isFrozen()) {
+        // Children are laid out in the same order as their entries.
+        const TriePtrs *head = (const TriePtrs*)(p->map + node + sizeof(TrieNode));
+        const TriePtrs *first = head + 1;
+        const TriePtrs *last = first + head->child;
+        const TriePtrs *found = lower_bound(first, last, child,
+                [](const TriePtrs &ptrs, const TrieOffset c) { return ptrs.child < c; });
+        if(found == last || found->child != child)
+            throw runtime_error("Trie is corrupted");
+        return (const char*)found - p->map;
+    }
     TrieOffset sibling = getSiblingList(node);
     while(getChild(sibling) != child) {
         sibling = getNextSibling(sibling);
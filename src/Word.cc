@@ -21,7 +21,8 @@
 #include <cstring>
 #include <stdexcept>
 #include <cassert>
-#include <cstring>
+#include <atomic>
+#include <new>
 #include "ColumbusHelpers.hh"
 
 using namespace std;
@@ -41,6 +42,22 @@ const static uint64_t randomNumbers[randomArrSize] = {
 0xc45e7d76ca927907, 0xc15c5589af3dbef0, 0xa8175814c7ff20f6, 0xaec21b2f3fddfc14,  0xaf247b61fd25583, 0x2d784f3af2691077, 0x58f3a2b1743759c6, 0x77115ac165a120a9,
 };
 
+/*
+ * Words keep their letters in a block that starts with this header.
+ * The letters follow it directly and are never modified, so copies
+ * just bump the reference count. Keeping the buffer behind the text
+ * pointer leaves the layout of Word as it always was.
+ */
+struct SharedLetters {
+    atomic<unsigned int> refs;
+};
+
+static_assert(sizeof(SharedLetters) % sizeof(Letter) == 0, "Shared letters would be misaligned.");
+
+static SharedLetters* sharedHeader(Letter *text) {
+    return reinterpret_cast<SharedLetters*>(reinterpret_cast<char*>(text) - sizeof(SharedLetters));
+}
+
 Word::Word() : text(0), len(0){
 }
 
@@ -52,55 +69,87 @@ Word::Word(const Word &w) : text(0), len(0) {
     duplicateFrom(w);
 }
 
-Word::Word(Word &&w) :
-    text(w.text),
-    len(w.len) {
-    w.len = 0;
-    w.text = 0;
+Word::Word(Word &&w) : text(0), len(0) {
+    moveFrom(w);
 }
 
-Word::Word(Letter *letters, size_t length) {
+Word::Word(const Letter *letters, size_t length) : text(0), len(0) {
     if(letters[length-1] == 0) {
-        text = new Letter[length];
-        len = length-1;
-    } else {
-        text = new Letter[length+1];
-        text[length] = 0;
-        len = length;
+        length--;
     }
-    memcpy(text, letters, length*sizeof(Letter));
+    Letter *buf = allocate(length);
+    memcpy(buf, letters, length*sizeof(Letter));
+    buf[length] = 0;
     if(hasWhitespace()) {
-        delete []text;
-        text = nullptr;
+        release();
         throw std::invalid_argument("Tried to create a Word with whitespace.");
     }
     else if(hasBrokenSurrogates()) {
-        delete []text;
-        text = nullptr;
+        release();
         throw std::invalid_argument("Tried to create a Word with broken surrogates.");
     }
 }
 
+/*
+ * Kept for binary compatibility.
+ */
+Word::Word(Letter *letters, size_t length) : Word(static_cast<const Letter*>(letters), length) {
+}
+
 Word::Word(const std::string &w) : text(0), len(0) {
     convertString(w.c_str());
 }
 
 Word::~Word() {
-    delete []text;
+    release();
+}
+
+/*
+ * Sets this word to an uninitialised string of the given length
+ * and returns the buffer the caller should fill in. The caller
+ * must also write the terminating zero.
+ */
+Letter* Word::allocate(const unsigned int length) {
+    release();
+    void *block = ::operator new(sizeof(SharedLetters) + (length+1)*sizeof(Letter));
+    SharedLetters *header = new(block) SharedLetters();
+    header->refs = 1;
+    text = reinterpret_cast<Letter*>(header+1);
+    len = length;
+    return text;
+}
+
+void Word::release() {
+    if(text) {
+        SharedLetters *header = sharedHeader(text);
+        if(--header->refs == 0) {
+            header->~SharedLetters();
+            ::operator delete(header);
+        }
+    }
+    text = nullptr;
+    len = 0;
 }
 
 void Word::convertString(const char *utf8Word) {
-    text = utf8ToInternal(utf8Word, len);
+    size_t bytes = strlen(utf8Word);
+    // UTF-8 never decodes to more letters than it has bytes, so the
+    // word is converted straight into its own buffer.
+    Letter *buf = allocate(bytes);
+    try {
+        len = utf8ToInternal(utf8Word, bytes, buf);
+    } catch(...) {
+        release();
+        throw;
+    }
     if(hasWhitespace()) {
-        delete []text;
-        text = nullptr;
+        release();
         std::string err("Tried to create a word with whitespace in it: ");
         err += (const char*)utf8Word;
         throw std::invalid_argument(err);
     }
     else if(hasBrokenSurrogates()) {
-        delete []text;
-        text = nullptr;
+        release();
         std::string err("Tried to create a word with broken surrogates in it: ");
         err += (const char*)utf8Word;
         throw std::invalid_argument(err);
@@ -111,14 +160,24 @@ void Word::duplicateFrom(const Word &w) {
     if(this == &w) {
         return;
     }
-    delete []text;
+    release();
+    if(!w.text) {
+        return;
+    }
+    sharedHeader(w.text)->refs++;
+    text = w.text;
     len = w.len;
-    if(len == 0) {
-        text = 0;
-    } else {
-        text = new Letter[len+1];
-        memcpy(text, w.text, (len+1)*sizeof(Letter));
+}
+
+void Word::moveFrom(Word &w) {
+    if(this == &w) {
+        return;
     }
+    release();
+    text = w.text;
+    len = w.len;
+    w.text = nullptr;
+    w.len = 0;
 }
 
 Letter Word::operator[](unsigned int i) const {
@@ -139,13 +198,7 @@ Word& Word::operator=(const Word &w) {
 }
 
 Word& Word::operator=(Word &&w) {
-    delete []text;
-
-    text = w.text;
-    len = w.len;
-
-    w.text = 0;
-    w.len = 0;
+    moveFrom(w);
     return *this;
 }
 
@@ -262,18 +315,15 @@ string Word::asUtf8() const {
 Word Word::join(const Word &w) const {
     Word result;
     size_t newLen = length() + w.length();
-    result.len = newLen;
-    result.text = new Letter[newLen+1];
-    memcpy(result.text, text, len*sizeof(Letter));
-    memcpy(result.text + len, w.text, w.len*sizeof(Letter));
-    result.text[newLen] = '\0';
+    Letter *buf = result.allocate(newLen);
+    memcpy(buf, text, len*sizeof(Letter));
+    memcpy(buf + len, w.text, w.len*sizeof(Letter));
+    buf[newLen] = '\0';
     return result;
 }
 
 Word& Word::operator=(const char *utf8Word) {
-    delete []text;
-    text = nullptr;
-    len = 0;
+    release();
     convertString(utf8Word);
     return *this;
 }
@@ -20,6 +20,8 @@
 #include "WordStore.hh"
 #include "Word.hh"
 #include "Trie.hh"
+#include "SnapshotFile.hh"
+#include "ContainerMemory.hh"
 #include <vector>
 #include <stdexcept>
 
@@ -56,12 +58,22 @@ WordID WordStore::getID(const Word &w) {
     if(p->words.hasWord(w)) {
         return p->words.getWordID(p->words.findWord(w));
     }
+    const bool wasSuccinct = p->words.isSuccinct();
     TrieOffset node = p->words.insertWord(w, p->wordIndex.size());
     p->wordIndex.push_back(node);
     WordID result = p->wordIndex.size()-1;
+    if(wasSuccinct)
+        findNodes();
     return result;
 }
 
+WordID WordStore::findID(const Word &w) const {
+    TrieOffset node = p->words.findWord(w);
+    if(!node)
+        return INVALID_WORDID;
+    return p->words.getWordID(node);
+}
+
 bool WordStore::hasWord(const Word &w) const {
     return p->words.hasWord(w);
 }
@@ -77,4 +89,60 @@ bool WordStore::hasWord(const WordID id) const {
     return id < p->wordIndex.size();
 }
 
+void WordStore::freeze() {
+    if(p->words.isFrozen())
+        return;
+    p->words.freeze();
+    findNodes();
+}
+
+void WordStore::compact() {
+    if(p->words.isSuccinct())
+        return;
+    p->words.makeSuccinct();
+    findNodes();
+}
+
+size_t WordStore::memoryUsage() const {
+    return p->words.memoryUsage() + vectorMemory(p->wordIndex);
+}
+
+/*
+ * Rebuilds the ID to node table after node offsets have changed.
+ */
+void WordStore::findNodes() {
+    const Trie &words = p->words;
+    vector<TrieOffset> nodes;
+    nodes.push_back(words.getRoot());
+    while(!nodes.empty()) {
+        const TrieOffset node = nodes.back();
+        nodes.pop_back();
+        const WordID id = words.getWordID(node);
+        if(id != INVALID_WORDID)
+            p->wordIndex[id] = node;
+        for(TrieOffset sibl = words.getSiblingList(node); sibl; sibl = words.getNextSibling(sibl))
+            nodes.push_back(words.getChild(sibl));
+    }
+}
+
+/*
+ * The words go into basename.trie and the id to node table into
+ * basename.ids.
+ */
+void WordStore::save(const std::string &basename) const {
+    p->words.save((basename + ".trie").c_str());
+    SnapshotWriter out(basename + ".ids", "wordstore");
+    out.writeArray(p->wordIndex.data(), p->wordIndex.size());
+    out.finish();
+}
+
+void WordStore::load(const std::string &basename) {
+    SnapshotReader in(basename + ".ids", "wordstore");
+    size_t count;
+    const TrieOffset *ids = in.readArray<TrieOffset>(count);
+    vector<TrieOffset> newIndex(ids, ids + count);
+    p->words.openReadOnly((basename + ".trie").c_str());
+    p->wordIndex.swap(newIndex);
+}
+
 COL_NAMESPACE_END
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks for the build and search hot paths.
+ *
+ * Everything runs on deterministic synthetic data so results can be
+ * compared between builds. For every benchmark it prints the mean and
+ * percentile time per operation along with heap allocations per
+ * operation, which are counted by replacing the global operator new.
+ *
+ * Run with "smoke" as the argument for a quick run that just checks
+ * that everything works. A number argument scales the data sizes.
+ */
+
+#include "Trie.hh"
+#include "LevenshteinIndex.hh"
+#include "IndexMatches.hh"
+#include "ErrorValues.hh"
+#include "Word.hh"
+#include "WordList.hh"
+#include "WordStore.hh"
+#include "Matcher.hh"
+#include "MatchResults.hh"
+#include "ColumbusHelpers.hh"
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <stdexcept>
+
+using namespace Columbus;
+using namespace std;
+
+static atomic<size_t> allocations(0);
+
+/*
+ * Every form that can allocate from or free to malloc must be replaced,
+ * or memory would be freed with a different allocator than it came
+ * from. The aligned forms only exist from C++17 on, which the library
+ * is not built with, so they are neither replaced nor counted.
+ */
+void* operator new(size_t size) {
+    allocations++;
+    void *ptr = malloc(size ? size : 1);
+    if(!ptr)
+        throw bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch(const bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return operator new(size, nothrow);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, const nothrow_t&) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, const nothrow_t&) noexcept {
+    free(ptr);
+}
+
+typedef chrono::steady_clock Clock;
+
+struct BenchResult {
+    size_t ops;
+    double mean; // Nanoseconds per operation.
+    double p50;
+    double p90;
+    double p99;
+    double allocsPerOp;
+};
+
+/*
+ * Times op(i) for i in [0, ops) one by one. The setup is not timed.
+ */
+static BenchResult runBenchmark(const size_t ops, const function<void(size_t)> &op) {
+    vector<double> times(ops);
+    const size_t allocStart = allocations;
+    for(size_t i=0; i<ops; i++) {
+        Clock::time_point start = Clock::now();
+        op(i);
+        Clock::time_point end = Clock::now();
+        times[i] = chrono::duration<double, nano>(end - start).count();
+    }
+    const size_t allocEnd = allocations;
+    BenchResult r;
+    r.ops = ops;
+    r.mean = 0;
+    for(const auto t : times)
+        r.mean += t;
+    r.mean /= ops;
+    sort(times.begin(), times.end());
+    r.p50 = times[ops*50/100];
+    r.p90 = times[ops*90/100];
+    r.p99 = times[ops*99/100];
+    r.allocsPerOp = double(allocEnd - allocStart)/ops;
+    return r;
+}
+
+// For operations that process many items at once.
+static BenchResult perItem(BenchResult r, const size_t items) {
+    r.mean /= items;
+    r.p50 /= items;
+    r.p90 /= items;
+    r.p99 /= items;
+    r.allocsPerOp /= items;
+    return r;
+}
+
+static void printHeader() {
+    printf("%-36s %8s %12s %12s %12s %12s %10s\n", "benchmark", "ops", "mean ns", "p50 ns", "p90 ns", "p99 ns", "allocs/op");
+}
+
+static void report(const string &name, const BenchResult &r) {
+    printf("%-36s %8lu %12.0f %12.0f %12.0f %12.0f %10.2f\n", name.c_str(), (unsigned long) r.ops,
+            r.mean, r.p50, r.p90, r.p99, r.allocsPerOp);
+}
+
+/*
+ * Words are made of random syllables so that they share prefixes and
+ * suffixes roughly like natural language does.
+ */
+class WordGenerator {
+private:
+    uint32_t seed;
+
+public:
+    explicit WordGenerator(const uint32_t s) : seed(s) {}
+
+    uint32_t next(const uint32_t range) {
+        seed = seed*1103515245 + 12345;
+        return (seed >> 8) % range;
+    }
+
+    string word(const size_t syllables) {
+        static const char *parts[] = {"ka", "to", "mi", "ser", "lan", "ed", "or", "in", "qu", "al",
+                "ber", "st", "ion", "ra", "ne", "ul", "ch", "py", "wo", "de"};
+        string w;
+        for(size_t i=0; i<syllables; i++)
+            w += parts[next(20)];
+        return w;
+    }
+
+    string word() {
+        return word(1 + next(5));
+    }
+};
+
+static vector<Word> makeVocabulary(const size_t size) {
+    WordGenerator gen(42);
+    vector<Word> words;
+    WordStore seen;
+    while(words.size() < size) {
+        Word w(gen.word());
+        if(seen.hasWord(w))
+            continue;
+        seen.getID(w);
+        words.push_back(w);
+    }
+    return words;
+}
+
+// A misspelled version of a vocabulary word with about the given length.
+static vector<Word> makeQueries(const size_t count, const size_t minLength, const size_t maxLength, WordGenerator &gen) {
+    vector<Word> queries;
+    while(queries.size() < count) {
+        string q = gen.word(1 + gen.next(6));
+        if(q.size() < minLength || q.size() > maxLength)
+            continue;
+        q[gen.next(q.size())] = 'a' + gen.next(26);
+        queries.push_back(Word(q));
+    }
+    return queries;
+}
+
+static void benchTrie(const vector<Word> &vocabulary) {
+    Trie t;
+    WordStore store;
+    vector<WordID> ids;
+    for(const auto &w : vocabulary)
+        ids.push_back(store.getID(w));
+    report("Trie::insertWord", runBenchmark(vocabulary.size(), [&](size_t i) {
+        t.insertWord(vocabulary[i], ids[i]);
+    }));
+    report("Trie::findWord", runBenchmark(vocabulary.size(), [&](size_t i) {
+        if(!t.findWord(vocabulary[i]))
+            throw runtime_error("Trie lost a word.");
+    }));
+    t.freeze();
+    report("Trie::findWord frozen", runBenchmark(vocabulary.size(), [&](size_t i) {
+        if(!t.findWord(vocabulary[i]))
+            throw runtime_error("Trie lost a word.");
+    }));
+}
+
+static void benchIndex(const vector<Word> &vocabulary, const size_t numQueries) {
+    LevenshteinIndex ind;
+    WordStore store;
+    ErrorValues e;
+    IndexMatches matches;
+    WordGenerator gen(7);
+    const int defaultError = LevenshteinIndex::getDefaultError();
+    for(const auto &w : vocabulary)
+        ind.insertWord(w, store.getID(w));
+    ind.freeze();
+    const struct {
+        const char *name;
+        size_t minLength;
+        size_t maxLength;
+    } lengths[] = {{"short", 2, 4}, {"medium", 5, 8}, {"long", 9, 30}};
+    for(const auto &l : lengths) {
+        vector<Word> queries = makeQueries(numQueries, l.minLength, l.maxLength, gen);
+        for(int errors=1; errors<=3; errors++) {
+            char name[64];
+            snprintf(name, sizeof(name), "findWords %s error %d", l.name, errors);
+            report(name, runBenchmark(queries.size(), [&](size_t i) {
+                matches.clear();
+                ind.findWords(queries[i], e, errors*defaultError, matches);
+            }));
+        }
+    }
+}
+
+static void addDocuments(Matcher &m, const vector<Word> &vocabulary, const size_t numDocs, WordGenerator &gen) {
+    static const Word fields[] = {Word("title"), Word("keywords")};
+    for(size_t d=0; d<numDocs; d++) {
+        for(const auto &field : fields) {
+            string text;
+            const size_t numWords = 1 + gen.next(5);
+            for(size_t i=0; i<numWords; i++) {
+                text += vocabulary[gen.next(vocabulary.size())].asUtf8();
+                text += " ";
+            }
+            m.addText(d, field, text);
+        }
+    }
+    m.commit();
+}
+
+static void benchMatcher(const vector<Word> &vocabulary, const size_t numDocs, const size_t numQueries, const size_t builds) {
+    WordGenerator gen(99);
+    report("Matcher build per document", perItem(runBenchmark(builds, [&](size_t) {
+        Matcher m;
+        WordGenerator buildGen(5);
+        addDocuments(m, vocabulary, numDocs, buildGen);
+    }), numDocs));
+
+    Matcher m;
+    WordGenerator buildGen(5);
+    addDocuments(m, vocabulary, numDocs, buildGen);
+    vector<string> queries;
+    vector<WordList> queryLists;
+    for(size_t i=0; i<numQueries; i++) {
+        vector<Word> words = makeQueries(1 + gen.next(3), 3, 12, gen);
+        string q;
+        for(const auto &w : words)
+            q += w.asUtf8() + " ";
+        queries.push_back(q);
+        queryLists.push_back(splitToWords(q.c_str()));
+    }
+    report("Matcher::match", runBenchmark(queries.size(), [&](size_t i) {
+        m.match(queries[i].c_str());
+    }));
+    const Word primary("title");
+    report("Matcher::onlineMatch", runBenchmark(queryLists.size(), [&](size_t i) {
+        m.onlineMatch(queryLists[i], primary);
+    }));
+}
+
+int main(int argc, char **argv) {
+    double scale = 1.0;
+    if(argc > 1) {
+        if(strcmp(argv[1], "smoke") == 0)
+            scale = 0.02;
+        else
+            scale = atof(argv[1]);
+    }
+    if(scale <= 0) {
+        printf("%s [smoke|scale]\n", argv[0]);
+        return 1;
+    }
+    try {
+        const size_t vocabularySize = max<size_t>(200, 50000*scale);
+        const size_t numQueries = max<size_t>(10, 500*scale);
+        const size_t numDocs = max<size_t>(100, 20000*scale);
+        const size_t builds = max<size_t>(1, 5*scale);
+        vector<Word> vocabulary = makeVocabulary(vocabularySize);
+        printf("Vocabulary %lu words, %lu documents, %lu queries per benchmark.\n",
+                (unsigned long) vocabulary.size(), (unsigned long) numDocs, (unsigned long) numQueries);
+        printHeader();
+        benchTrie(vocabulary);
+        benchIndex(vocabulary, numQueries);
+        benchMatcher(vocabulary, numDocs, numQueries, builds);
+    } catch(const exception &e) {
+        fprintf(stderr, "Fail: %s\n", e.what());
+        return 666;
+    }
+    return 0;
+}
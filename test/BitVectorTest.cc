@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file tests the rank and select bit vector of the succinct trie.
+ */
+
+#include "BitVector.hh"
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+using namespace Columbus;
+using namespace std;
+
+static void buildImage(const vector<bool> &bits, vector<uint64_t> &image) {
+    size_t ones = 0;
+    // Garbage past the end must not matter.
+    vector<uint64_t> packed((bits.size() + 63) / 64, ~(uint64_t)0);
+    for(size_t i=0; i<bits.size(); i++) {
+        if(bits[i])
+            ones++;
+        else
+            packed[i/64] &= ~(((uint64_t)1) << (i%64));
+    }
+    image.assign(BitVector::imageSize(bits.size(), ones) / sizeof(uint64_t), 0);
+    BitVector::build(packed.data(), bits.size(), image.data());
+}
+
+static void checkAgainstNaive(const vector<bool> &bits) {
+    vector<uint64_t> image;
+    BitVector v;
+    size_t ones = 0;
+    size_t zeros = 0;
+    buildImage(bits, image);
+    assert(v.attach(image.data(), image.size()*sizeof(uint64_t)) == image.size()*sizeof(uint64_t));
+    assert(v.size() == bits.size());
+    for(size_t i=0; i<bits.size(); i++) {
+        assert(v.get(i) == bits[i]);
+        assert(v.rank1(i) == ones);
+        assert(v.rank0(i) == zeros);
+        if(bits[i]) {
+            assert(v.select1(ones) == i);
+            ones++;
+        } else {
+            assert(v.select0(zeros) == i);
+            zeros++;
+        }
+    }
+    assert(v.ones() == ones);
+}
+
+void testEmpty() {
+    checkAgainstNaive(vector<bool>());
+}
+
+void testPatterns() {
+    unsigned int seed = 1;
+    for(size_t length : {1, 63, 64, 65, 1000, 5000}) {
+        vector<bool> allOnes(length, true);
+        vector<bool> allZeros(length, false);
+        vector<bool> sparse(length, false);
+        vector<bool> random(length);
+        for(size_t i=0; i<length; i+=97)
+            sparse[i] = true;
+        for(size_t i=0; i<length; i++) {
+            seed = seed*1103515245 + 12345;
+            random[i] = (seed >> 16) & 1;
+        }
+        checkAgainstNaive(allOnes);
+        checkAgainstNaive(allZeros);
+        checkAgainstNaive(sparse);
+        checkAgainstNaive(random);
+    }
+}
+
+void testTruncated() {
+    vector<bool> bits(300, true);
+    vector<uint64_t> image;
+    BitVector v;
+    bool failed = false;
+    buildImage(bits, image);
+    try {
+        v.attach(image.data(), image.size()*sizeof(uint64_t) - 8);
+    } catch(const std::runtime_error &e) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+int main(int /*argc*/, char **/*argv*/) {
+    try {
+        testEmpty();
+        testPatterns();
+        testTruncated();
+    } catch(const std::exception &e) {
+        fprintf(stderr, "Fail: %s\n", e.what());
+        return 666;
+    }
+    return 0;
+}
@@ -32,7 +32,6 @@ using namespace Columbus;
 
 Matcher* build_matcher(const char *dataFile, int maxLines) {
     Matcher *m = 0;
-    Corpus *c = new Corpus();
     const int batchSize = 100000;
     Word field("name");
     double dataReadStart, dataReadEnd;
@@ -48,26 +47,21 @@ Matcher* build_matcher(const char *dataFile, int maxLines) {
 
     m = new Matcher();
 
-    // Build Corpus.
+    // Stream the lines straight into the matcher.
     dataReadStart = hiresTimestamp();
     while(getline(ifile, line)) {
         if(line.size() == 0)
             continue;
         totalDocs++;
-        Document d(totalDocs);
-        d.addText(field, line.c_str());
-        c->addDocument(d);
+        m->addText(totalDocs, field, line);
         i++;
         if(i % batchSize == 0) {
-            m->index(*c);
-            delete c;
-            c = new Corpus();
+            m->commit();
         }
         if(i >= maxLines)
             break;
     }
-    m->index(*c);
-    delete c;
+    m->commit();
     dataReadEnd = hiresTimestamp();
     printf("Read in %lu documents in %.2f seconds.\n", (unsigned long)totalDocs, dataReadEnd - dataReadStart);
     return m;
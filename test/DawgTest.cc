@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file tests the minimized word graph.
+ */
+
+#include "Dawg.hh"
+#include "Trie.hh"
+#include "Word.hh"
+#include "SnapshotFile.hh"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace Columbus;
+using namespace std;
+
+static void collectWords(const Dawg &d, const GraphOffset node, string &prefix, map<string, WordID> &words) {
+    if(d.getWordID(node) != INVALID_WORDID) {
+        assert(words.find(prefix) == words.end());
+        words[prefix] = d.getWordID(node);
+    }
+    for(GraphOffset sibl = d.getSiblingList(node); sibl; sibl = d.getNextSibling(sibl)) {
+        prefix.push_back((char)d.getLetter(sibl));
+        collectWords(d, d.getChild(sibl), prefix, words);
+        prefix.erase(prefix.size()-1);
+    }
+}
+
+static map<string, WordID> suffixWords(Trie &t) {
+    const char *stems[] = {"walk", "talk", "jump", "bump", "hunt", "print"};
+    const char *endings[] = {"", "s", "ed", "ing", "er", "ers"};
+    map<string, WordID> words;
+    WordID id = 100;
+    for(const auto stem : stems) {
+        for(const auto ending : endings) {
+            string w = string(stem) + ending;
+            t.insertWord(Word(w.c_str()), id);
+            words[w] = id;
+            id += 7;
+        }
+    }
+    t.insertWord(Word("walkabout"), 3);
+    words["walkabout"] = 3;
+    return words;
+}
+
+void testBuild() {
+    Trie t;
+    Dawg d;
+    map<string, WordID> words = suffixWords(t);
+    map<string, WordID> found;
+    string prefix;
+    d.build(t);
+    assert(d.numWords() == words.size());
+    // The endings are stored only once.
+    assert(d.numNodes() < t.numNodes()/2);
+    collectWords(d, d.getRoot(), prefix, found);
+    assert(found == words);
+    for(const auto &w : words) {
+        GraphOffset node = d.findWord(Word(w.first.c_str()));
+        assert(node);
+        assert(d.getWordID(node) == w.second);
+    }
+    assert(d.getWordID(d.findWord(Word("walkin"))) == INVALID_WORDID);
+    assert(!d.findWord(Word("xyz")));
+    assert(!d.findWord(Word("walkers1")));
+}
+
+void testEmpty() {
+    Trie t;
+    Dawg d;
+    d.build(t);
+    assert(d.numWords() == 0);
+    assert(d.getSiblingList(d.getRoot()) == 0);
+    assert(d.getWordID(d.getRoot()) == INVALID_WORDID);
+    assert(!d.findWord(Word("a")));
+}
+
+void testCopy() {
+    Trie t;
+    Trie copy;
+    Dawg d;
+    map<string, WordID> words = suffixWords(t);
+    d.build(t);
+    d.copyTo(copy);
+    assert(copy.numWords() == words.size());
+    assert(copy.numNodes() == t.numNodes());
+    for(const auto &w : words)
+        assert(copy.getWordID(copy.findWord(Word(w.first.c_str()))) == w.second);
+}
+
+void testSaveLoad() {
+    char fname[] = "/tmp/columbus_dawgtest_XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+    Trie t;
+    Dawg d;
+    Dawg loaded;
+    map<string, WordID> words = suffixWords(t);
+    map<string, WordID> found;
+    string prefix;
+    d.build(t);
+    {
+        SnapshotWriter out(fname, "dawg");
+        d.save(out);
+        out.finish();
+    }
+    {
+        SnapshotReader in(fname, "dawg");
+        loaded.load(in);
+    }
+    collectWords(loaded, loaded.getRoot(), prefix, found);
+    assert(found == words);
+
+    // A graph whose word counts do not add up must be rejected.
+    {
+        SnapshotWriter out(fname, "dawg");
+        // Nodes are two 32 bit fields, edges a letter and a 32 bit target.
+        uint32_t nodes[4] = {0, 0, 0, 5};
+        uint32_t edge[2] = {0, 0x80000000};
+        WordID ids[5] = {1, 2, 3, 4, 5};
+        out.writeValue(1);
+        out.writeArray(nodes, 4);
+        out.writeArray(edge, 2);
+        out.writeArray(ids, 5);
+        out.finish();
+    }
+    bool failed = false;
+    try {
+        SnapshotReader in(fname, "dawg");
+        loaded.load(in);
+    } catch(const std::runtime_error &e) {
+        failed = true;
+    }
+    assert(failed);
+    assert(loaded.numWords() == words.size());
+    unlink(fname);
+}
+
+int main(int /*argc*/, char **/*argv*/) {
+    try {
+        testBuild();
+        testEmpty();
+        testCopy();
+        testSaveLoad();
+    } catch(const std::exception &e) {
+        fprintf(stderr, "Fail: %s\n", e.what());
+        return 666;
+    }
+    return 0;
+}
@@ -22,9 +22,14 @@
  */
 
 #include <cassert>
+#include <map>
+#include <string>
+#include <vector>
 #include "LevenshteinIndex.hh"
 #include "Word.hh"
 #include "ErrorValues.hh"
+#include "LevenshteinAutomaton.hh"
+#include "IncrementalSearch.hh"
 
 using namespace Columbus;
 using namespace std;
@@ -305,6 +310,457 @@ void testStartError() {
     assert(matches.getMatch(0) == w1ID);
 }
 
+static vector<string> randomLetters(unsigned int &seed, const size_t maxLength) {
+    // A small alphabet with a non-ASCII letter to get plenty of near matches.
+    static const char *letters[] = {"a", "b", "c", "d", "e", "\xc3\xa4"};
+    vector<string> result;
+    seed = seed*1103515245 + 12345;
+    size_t length = 1 + (seed >> 16) % maxLength;
+    for(size_t i=0; i<length; i++) {
+        seed = seed*1103515245 + 12345;
+        result.push_back(letters[(seed >> 16) % 6]);
+    }
+    return result;
+}
+
+static Word prefix(const vector<string> &letters, const size_t length) {
+    string text;
+    for(size_t i=0; i<length; i++)
+        text += letters[i];
+    return Word(text.c_str());
+}
+
+static string randomText(unsigned int &seed, const size_t maxLength) {
+    string result;
+    for(const auto &l : randomLetters(seed, maxLength))
+        result += l;
+    return result;
+}
+
+static map<WordID, int> matchMap(const IndexMatches &matches) {
+    map<WordID, int> result;
+    for(size_t i=0; i<matches.size(); i++) {
+        assert(result.find(matches.getMatch(i)) == result.end());
+        result[matches.getMatch(i)] = matches.getMatchError(i);
+    }
+    for(size_t i=1; i<matches.size(); i++)
+        assert(matches.getMatchError(i-1) <= matches.getMatchError(i));
+    return result;
+}
+
+static void fillIndex(LevenshteinIndex &ind, unsigned int seed, const size_t numWords) {
+    for(WordID i=1; i<=numWords; i++) {
+        Word w(randomText(seed, 9).c_str());
+        if(!ind.hasWord(w))
+            ind.insertWord(w, i);
+    }
+}
+
+void testBitParallel() {
+    LevenshteinIndex ind;
+    ErrorValues uniform;
+    ErrorValues generic;
+    const int defaultError = LevenshteinIndex::getDefaultError();
+    unsigned int seed = 42;
+
+    // Any custom letter pair disables the bit-parallel search.
+    generic.setError(Letter('x'), Letter('y'), defaultError);
+    assert(uniform.hasUniformErrors(5));
+    assert(!generic.hasUniformErrors(5));
+
+    for(WordID i=1; i<=500; i++) {
+        Word w(randomText(seed, 8).c_str());
+        if(!ind.hasWord(w))
+            ind.insertWord(w, i);
+    }
+    for(int i=0; i<200; i++) {
+        Word query(randomText(seed, 10).c_str());
+        for(int maxError=0; maxError<=3*defaultError; maxError+=defaultError/2) {
+            IndexMatches fast;
+            IndexMatches slow;
+            ind.findWords(query, uniform, maxError, fast);
+            ind.findWords(query, generic, maxError, slow);
+            assert(matchMap(fast) == matchMap(slow));
+        }
+    }
+
+    Word transposed("bacde");
+    Word original("abcde");
+    IndexMatches matches;
+    LevenshteinIndex small;
+    small.insertWord(original, 1);
+    small.findWords(transposed, uniform, defaultError, matches);
+    assert(matches.size() == 1);
+    assert(matches.getMatchError(0) == defaultError);
+}
+
+void testCompletions() {
+    LevenshteinIndex ind;
+    ErrorValues e;
+    IndexMatches matches;
+    const int defaultError = LevenshteinIndex::getDefaultError();
+    const char *words[] = {"save", "saved", "saves", "saving", "safe", "print"};
+    const int counts[] = {1, 5, 3, 2, 1, 4};
+    for(WordID i=0; i<6; i++) {
+        for(int j=0; j<counts[i]; j++)
+            ind.insertWord(Word(words[i]), i+1);
+    }
+
+    ind.findCompletions(Word("sav"), e, 0, matches);
+    assert(matches.size() == 4);
+    assert(matches.getMatch(0) == 2);
+    assert(matches.getMatch(1) == 3);
+    assert(matches.getMatch(2) == 4);
+    assert(matches.getMatch(3) == 1);
+    for(size_t i=0; i<matches.size(); i++)
+        assert(matches.getMatchError(i) == 0);
+
+    matches.clear();
+    ind.findCompletions(Word("sav"), e, defaultError, matches);
+    assert(matches.size() == 5);
+    assert(matches.getMatch(4) == 5);
+    assert(matches.getMatchError(4) == defaultError);
+
+    // Only the most common completions of a prefix are returned.
+    LevenshteinIndex many;
+    for(WordID i=1; i<=30; i++) {
+        string w("pa");
+        w += string(1, 'a' + (i-1)%26) + string(1, 'a' + (i-1)/26);
+        for(WordID j=0; j<i; j++)
+            many.insertWord(Word(w.c_str()), i);
+    }
+    matches.clear();
+    many.findCompletions(Word("pa"), e, 0, matches);
+    assert(matches.size() == LevenshteinIndex::COMPLETIONS_PER_PREFIX);
+    for(size_t i=0; i<matches.size(); i++)
+        assert(matches.getMatch(i) == 30-i);
+}
+
+/*
+ * With at most COMPLETIONS_PER_PREFIX words no completion list is cut
+ * short. Completions are then every word with a prefix that a regular
+ * search of all prefixes finds, with the error of its best prefix.
+ */
+void testCompletionErrors() {
+    const char letters[] = "abcde";
+    ErrorValues uniform;
+    ErrorValues substring;
+    substring.setSubstringMode();
+    unsigned int seed = 11;
+    for(int round=0; round<50; round++) {
+        LevenshteinIndex ind;
+        LevenshteinIndex prefixes;
+        vector<vector<WordID> > completes(1);
+        map<string, WordID> prefixIDs;
+        WordID i = 1;
+        while(i <= LevenshteinIndex::COMPLETIONS_PER_PREFIX) {
+            string w;
+            seed = seed*1103515245 + 12345;
+            size_t length = 1 + (seed >> 16) % 6;
+            for(size_t j=0; j<length; j++) {
+                seed = seed*1103515245 + 12345;
+                w += letters[(seed >> 16) % 5];
+            }
+            if(ind.hasWord(Word(w.c_str())))
+                continue;
+            ind.insertWord(Word(w.c_str()), i);
+            for(size_t j=1; j<=w.size(); j++) {
+                const string prefix = w.substr(0, j);
+                if(prefixIDs.find(prefix) == prefixIDs.end()) {
+                    prefixIDs[prefix] = completes.size();
+                    completes.push_back(vector<WordID>());
+                    prefixes.insertWord(Word(prefix.c_str()), prefixIDs[prefix]);
+                }
+                completes[prefixIDs[prefix]].push_back(i);
+            }
+            i++;
+        }
+        for(int i=0; i<20; i++) {
+            Word query(randomText(seed, 5).c_str());
+            for(const ErrorValues *e : {&uniform, &substring}) {
+                for(int maxError=0; maxError<=300; maxError+=50) {
+                    IndexMatches expected;
+                    IndexMatches result;
+                    map<WordID, int> best;
+                    prefixes.findWords(query, *e, maxError, expected);
+                    for(size_t j=0; j<expected.size(); j++) {
+                        for(const auto w : completes[expected.getMatch(j)]) {
+                            if(best.find(w) == best.end() || expected.getMatchError(j) < best[w])
+                                best[w] = expected.getMatchError(j);
+                        }
+                    }
+                    ind.findCompletions(query, *e, maxError, result);
+                    assert(matchMap(result) == best);
+                }
+            }
+        }
+    }
+}
+
+typedef void (LevenshteinIndex::*Packer)();
+
+/*
+ * Every kind of search must give the same results after the trie has
+ * been repacked.
+ */
+static void checkPackedSearches(Packer pack) {
+    LevenshteinIndex ind;
+    ErrorValues uniform;
+    ErrorValues substring;
+    substring.setSubstringMode();
+    const int maxError = 2*LevenshteinIndex::getDefaultError();
+    vector<Word> queries;
+    vector<Word> words;
+    vector<map<WordID, int> > before;
+    unsigned int seed = 3;
+    WordID id = 1;
+    for(int i=0; i<500; i++) {
+        Word w(randomText(seed, 7).c_str());
+        if(ind.hasWord(w))
+            continue;
+        for(WordID count=0; count <= id % 3; count++)
+            ind.insertWord(w, id);
+        words.push_back(w);
+        id++;
+    }
+    for(int i=0; i<30; i++)
+        queries.push_back(Word(randomText(seed, 6).c_str()));
+    for(int round=0; round<2; round++) {
+        size_t k = 0;
+        for(const auto &q : queries) {
+            for(const ErrorValues *e : {&uniform, &substring}) {
+                IndexMatches matches;
+                IndexMatches completions;
+                IndexMatches automatonMatches;
+                IndexMatches incrementalMatches;
+                LevenshteinAutomaton a(q, *e, maxError);
+                IncrementalSearch s(*e);
+                ind.findWords(q, *e, maxError, matches);
+                ind.findCompletions(q, *e, LevenshteinIndex::getDefaultError(), completions);
+                ind.findWords(a, automatonMatches);
+                ind.findWords(s, q, maxError, incrementalMatches);
+                if(round == 0) {
+                    before.push_back(matchMap(matches));
+                    before.push_back(matchMap(completions));
+                } else {
+                    assert(matchMap(matches) == before[k++]);
+                    assert(matchMap(completions) == before[k++]);
+                }
+                assert(matchMap(automatonMatches) == matchMap(matches));
+                assert(matchMap(incrementalMatches) == matchMap(matches));
+            }
+        }
+        if(round == 0) {
+            const size_t numNodes = ind.numNodes();
+            const size_t numWords = ind.numWords();
+            (ind.*pack)();
+            assert(ind.numNodes() <= numNodes);
+            assert(ind.numWords() == numWords);
+            for(const auto &w : words)
+                assert(ind.hasWord(w));
+            assert(!ind.hasWord(Word("aaaaaaaaaa")));
+        }
+    }
+    // Adding to a packed index must keep the completions right.
+    ind.insertWord(Word("abcde"), id);
+    ind.insertWord(Word("abcde"), id);
+    ind.insertWord(Word("abcde"), id);
+    assert(ind.hasWord(Word("abcde")));
+    IndexMatches completions;
+    ind.findCompletions(Word("abcd"), uniform, 0, completions);
+    assert(matchMap(completions).count(id) == 1);
+}
+
+void testPacking() {
+    checkPackedSearches(&LevenshteinIndex::freeze);
+    checkPackedSearches(&LevenshteinIndex::compact);
+    checkPackedSearches(&LevenshteinIndex::minimize);
+}
+
+void testWorkCounters() {
+    LevenshteinIndex ind;
+    ErrorValues uniform;
+    ErrorValues generic;
+    IncrementalSearch s(uniform);
+    const int defaultError = LevenshteinIndex::getDefaultError();
+    Word query("abd");
+    generic.setError(Letter('x'), Letter('y'), defaultError);
+    ind.insertWord(Word("abc"), 1);
+    ind.insertWord(Word("abcd"), 2);
+    ind.insertWord(Word("xyz"), 3);
+
+    IndexMatches fast;
+    IndexMatches slow;
+    IndexMatches automaton;
+    IndexMatches incremental;
+    IndexMatches completions;
+    LevenshteinAutomaton a(query, generic, defaultError);
+    ind.findWords(query, uniform, defaultError, fast);
+    ind.findWords(query, generic, defaultError, slow);
+    ind.findWords(a, automaton);
+    ind.findWords(s, query, defaultError, incremental);
+    ind.findCompletions(query, uniform, defaultError, completions);
+    assert(fast.getNodesVisited() > 0);
+    assert(slow.getNodesVisited() > 0);
+    assert(automaton.getNodesVisited() == slow.getNodesVisited());
+    assert(incremental.getNodesVisited() > 0);
+    assert(completions.getNodesVisited() > 0);
+    assert(slow.getCellsComputed() == slow.getNodesVisited()*(query.length()+1));
+    assert(automaton.getCellsComputed() > 0);
+    assert(automaton.getCellsComputed() <= slow.getCellsComputed());
+    assert(incremental.getCellsComputed() > 0);
+
+    // A second run with the same automaton reuses all of its rows.
+    IndexMatches again;
+    ind.findWords(a, again);
+    assert(again.getNodesVisited() == automaton.getNodesVisited());
+    assert(again.getCellsComputed() == 0);
+    again.clear();
+    assert(again.getNodesVisited() == 0);
+    assert(again.getCellsComputed() == 0);
+}
+
+static void compareAutomatonSearches(const LevenshteinIndex &ind, const ErrorValues &e, const size_t maxStates) {
+    unsigned int seed = 7;
+    for(int i=0; i<100; i++) {
+        Word query(randomText(seed, 10).c_str());
+        for(int maxError=0; maxError<=250; maxError+=50) {
+            LevenshteinAutomaton a(query, e, maxError, maxStates);
+            // Run twice to also check the memoized transitions.
+            for(int round=0; round<2; round++) {
+                IndexMatches expected;
+                IndexMatches result;
+                ind.findWords(query, e, maxError, expected);
+                ind.findWords(a, result);
+                assert(matchMap(expected) == matchMap(result));
+            }
+            assert(a.numStates() <= maxStates);
+        }
+    }
+}
+
+static void setWeightedErrors(ErrorValues &e) {
+    e.addKeyboardErrors();
+    e.setError(Letter('a'), Letter(0xe4), 20);
+    e.setTransposeError(70);
+    e.setEndDeletionError(30);
+    e.setStartInsertionError(40);
+    e.setSubstringStartLimit(3);
+}
+
+void testAutomaton() {
+    LevenshteinIndex weightedInd, uniformInd, limitInd;
+    ErrorValues weighted, uniform, limited;
+    fillIndex(weightedInd, 42, 400);
+    setWeightedErrors(weighted);
+    compareAutomatonSearches(weightedInd, weighted, LevenshteinAutomaton::DEFAULT_MAX_STATES);
+
+    fillIndex(uniformInd, 43, 200);
+    compareAutomatonSearches(uniformInd, uniform, LevenshteinAutomaton::DEFAULT_MAX_STATES);
+
+    fillIndex(limitInd, 44, 300);
+    limited.setError(Letter('b'), Letter('d'), 40);
+    compareAutomatonSearches(limitInd, limited, 1);
+    compareAutomatonSearches(limitInd, limited, 20);
+}
+
+void testAutomatonSharing() {
+    LevenshteinIndex ind1, ind2;
+    ErrorValues e;
+    IndexMatches m1, m2;
+    Word query("abcd");
+    e.setError(Letter('c'), Letter('x'), 10);
+    ind1.insertWord(Word("abxd"), 1);
+    ind1.insertWord(Word("bacd"), 2);
+    ind2.insertWord(Word("abcd"), 3);
+    ind2.insertWord(Word("zzzz"), 4);
+
+    LevenshteinAutomaton a(query, e, LevenshteinIndex::getDefaultError());
+    ind1.findWords(a, m1);
+    ind2.findWords(a, m2);
+    assert(m1.size() == 2);
+    assert(m1.getMatch(0) == 1);
+    assert(m1.getMatchError(0) == 10);
+    assert(m1.getMatch(1) == 2);
+    assert(m1.getMatchError(1) == e.getTransposeError());
+    assert(m2.size() == 1);
+    assert(m2.getMatch(0) == 3);
+    assert(m2.getMatchError(0) == 0);
+}
+
+static void checkIncrementalSearch(const LevenshteinIndex &ind, const ErrorValues &e, IncrementalSearch &s,
+        const Word &query, const int maxError) {
+    IndexMatches expected;
+    IndexMatches result;
+    ind.findWords(query, e, maxError, expected);
+    ind.findWords(s, query, maxError, result);
+    assert(matchMap(expected) == matchMap(result));
+}
+
+/*
+ * Types every query in one letter at a time. The maximum error grows
+ * with the query like the dynamic error of SearchParameters does.
+ */
+static void typeQueries(const LevenshteinIndex &ind, const ErrorValues &e) {
+    unsigned int seed = 7;
+    IncrementalSearch s(e);
+    for(int i=0; i<50; i++) {
+        vector<string> query = randomLetters(seed, 10);
+        for(size_t length=1; length<=query.size(); length++) {
+            const int maxError = length < 3 ? 100 : 200;
+            checkIncrementalSearch(ind, e, s, prefix(query, length), maxError);
+            // Same query again with a different error.
+            checkIncrementalSearch(ind, e, s, prefix(query, length), maxError/2);
+        }
+        // Going back starts over.
+        checkIncrementalSearch(ind, e, s, prefix(query, 1), 100);
+    }
+}
+
+void testTyping() {
+    LevenshteinIndex weightedInd, uniformInd;
+    ErrorValues weighted, uniform;
+    fillIndex(weightedInd, 42, 400);
+    setWeightedErrors(weighted);
+    typeQueries(weightedInd, weighted);
+
+    fillIndex(uniformInd, 43, 200);
+    typeQueries(uniformInd, uniform);
+}
+
+void testIncremental() {
+    LevenshteinIndex ind1, ind2;
+    ErrorValues e;
+    IncrementalSearch s(e);
+    IndexMatches m;
+    ind1.insertWord(Word("abcd"), 1);
+    ind1.insertWord(Word("abce"), 2);
+    ind1.insertWord(Word("zzzz"), 3);
+    ind2.insertWord(Word("abcd"), 4);
+
+    assert(s.numNodes() == 0);
+    ind1.findWords(s, Word("ab"), 0, m);
+    assert(m.size() == 0);
+    const size_t nodes = s.numNodes();
+    assert(nodes > 0);
+    m.clear();
+    ind1.findWords(s, Word("abcd"), 0, m);
+    assert(m.size() == 1);
+    assert(m.getMatch(0) == 1);
+    assert(s.numNodes() > nodes);
+    assert(s.numNodes() < 9); // The zzzz branch was never expanded.
+
+    // A different index starts over.
+    m.clear();
+    ind2.findWords(s, Word("abcd"), 0, m);
+    assert(m.size() == 1);
+    assert(m.getMatch(0) == 4);
+    assert(s.numNodes() == 4);
+
+    s.reset();
+    assert(s.numNodes() == 0);
+}
+
 int main(int /*argc*/, char **/*argv*/) {
     try {
         testTrivial();
@@ -316,6 +772,15 @@ int main(int /*argc*/, char **/*argv*/) {
         testTranspose();
         testEndError();
         testStartError();
+        testBitParallel();
+        testCompletions();
+        testCompletionErrors();
+        testPacking();
+        testWorkCounters();
+        testAutomaton();
+        testAutomatonSharing();
+        testTyping();
+        testIncremental();
     } catch(const std::exception &e) {
         fprintf(stderr, "Fail: %s\n", e.what());
         return 666;
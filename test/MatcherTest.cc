@@ -24,7 +24,20 @@
 #include "Document.hh"
 #include "MatchResults.hh"
 #include "ColumbusHelpers.hh"
+#include "SearchParameters.hh"
+#include "ResultFilter.hh"
+#include "QuerySession.hh"
+#include "MemoryUsage.hh"
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+#include <dirent.h>
+#include <unistd.h>
 
 using namespace Columbus;
 using namespace std;
@@ -290,10 +303,474 @@ void testPerfect() {
     assert(matches.getDocumentID(0) == correct);
 }
 
+static vector<string> listDirectory(const string &dirName) {
+    vector<string> entries;
+    DIR *dir = opendir(dirName.c_str());
+    assert(dir);
+    struct dirent *entry;
+    while((entry = readdir(dir)) != nullptr) {
+        string fname(entry->d_name);
+        if(fname != "." && fname != "..")
+            entries.push_back(fname);
+    }
+    closedir(dir);
+    return entries;
+}
+
+static void removeDirectory(const string &dirName) {
+    for(const auto &fname : listDirectory(dirName)) {
+        const string path = dirName + "/" + fname;
+        if(unlink(path.c_str()) != 0)
+            removeDirectory(path);
+    }
+    rmdir(dirName.c_str());
+}
+
+static bool sameResults(const MatchResults &r1, const MatchResults &r2) {
+    if(r1.size() != r2.size())
+        return false;
+    for(size_t i=0; i<r1.size(); i++) {
+        if(r1.getDocumentID(i) != r2.getDocumentID(i) ||
+                r1.getRelevancy(i) != r2.getRelevancy(i))
+            return false;
+    }
+    return true;
+}
+
+void testSnapshot() {
+    char dirTemplate[] = "/tmp/columbus_snapshot_XXXXXX";
+    char *dirName = mkdtemp(dirTemplate);
+    assert(dirName);
+    string snapshotDir = string(dirName) + "/snapshot";
+    Corpus *c = testCorpus();
+    Word textName("title");
+    WordList q = splitToWords("abc");
+    Matcher original;
+    Matcher loaded;
+
+    original.index(*c);
+    delete c;
+    original.saveSnapshot(snapshotDir);
+    loaded.loadSnapshot(snapshotDir);
+
+    assert(sameResults(original.match("abc"), loaded.match("abc")));
+    assert(sameResults(original.match("faraway test"), loaded.match("faraway test")));
+    assert(sameResults(original.onlineMatch(q, textName), loaded.onlineMatch(q, textName)));
+
+    // A loaded matcher can still be extended.
+    Corpus more;
+    Document d(2000);
+    d.addText(textName, "abc newword");
+    more.addDocument(d);
+    loaded.index(more);
+    assert(loaded.match("newword").size() == 1);
+    assert(loaded.match("newword").getDocumentID(0) == 2000);
+    assert(loaded.match("abc").size() == 3);
+
+    // A failed load must not destroy the current contents.
+    bool failed = false;
+    try {
+        loaded.loadSnapshot(string(dirName) + "/nonexisting");
+    } catch(const std::exception &e) {
+        failed = true;
+    }
+    assert(failed);
+    assert(loaded.match("newword").size() == 1);
+
+    // Saving over the snapshot the matcher was loaded from replaces it.
+    Matcher reloaded;
+    reloaded.loadSnapshot(snapshotDir);
+    reloaded.index(more);
+    reloaded.saveSnapshot(snapshotDir);
+    assert(sameResults(loaded.match("abc newword"), reloaded.match("abc newword")));
+    assert(listDirectory(snapshotDir).size() == 2);
+    Matcher third;
+    third.loadSnapshot(snapshotDir);
+    assert(sameResults(loaded.match("abc newword"), third.match("abc newword")));
+
+    removeDirectory(snapshotDir);
+    rmdir(dirName);
+}
+
+static Corpus* multiFieldCorpus(const DocumentID firstID, const DocumentID numDocs) {
+    const char *words[] = {"open", "close", "save", "print", "preview", "quit", "undo", "redo",
+            "copy", "paste", "find", "replace", "zoom", "window", "help", "about"};
+    const char *fields[] = {"title", "keywords", "description"};
+    Corpus *c = new Corpus();
+    unsigned int seed = 3 + firstID;
+    for(DocumentID id=firstID; id<firstID+numDocs; id++) {
+        Document d(id);
+        for(const auto field : fields) {
+            string text;
+            for(int i=0; i<3; i++) {
+                seed = seed*1103515245 + 12345;
+                text += words[(seed >> 16) % 16];
+                text += " ";
+            }
+            d.addText(Word(field), text.c_str());
+        }
+        c->addDocument(d);
+    }
+    return c;
+}
+
+void testThreads() {
+    Corpus *c = multiFieldCorpus(0, 200);
+    Matcher serial;
+    Matcher parallel;
+    const char *queries[] = {"opne", "save print", "zom windw help", "redo undo copy paste", "xyz"};
+
+    assert(serial.getThreadCount() == 1);
+    serial.index(*c);
+    parallel.index(*c);
+    delete c;
+    parallel.setThreadCount(4);
+    assert(parallel.getThreadCount() == 4);
+    for(const auto q : queries) {
+        assert(sameResults(serial.match(q), parallel.match(q)));
+        WordList query = splitToWords(q);
+        assert(sameResults(serial.onlineMatch(query, Word("title")), parallel.onlineMatch(query, Word("title"))));
+    }
+    assert(serial.match("save print").size() > 0);
+    parallel.setThreadCount(1);
+    assert(parallel.getThreadCount() == 1);
+    assert(sameResults(serial.match("save print"), parallel.match("save print")));
+
+    bool failed = false;
+    try {
+        parallel.setThreadCount(0);
+    } catch(const std::invalid_argument &e) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+void testParallelBuild() {
+    Corpus *c1 = multiFieldCorpus(0, 1000);
+    Corpus *c2 = multiFieldCorpus(5000, 300);
+    Matcher serial;
+    Matcher parallel;
+    const char *queries[] = {"opne", "save print", "zom windw help", "redo undo copy paste", "about"};
+
+    parallel.setThreadCount(3);
+    serial.index(*c1);
+    parallel.index(*c1);
+    for(const auto q : queries) {
+        assert(sameResults(serial.match(q), parallel.match(q)));
+    }
+    // Adding more documents later must give the same result too.
+    serial.index(*c2);
+    parallel.index(*c2);
+    delete c1;
+    delete c2;
+    for(const auto q : queries) {
+        MatchResults r = serial.match(q);
+        assert(sameResults(r, parallel.match(q)));
+        WordList query = splitToWords(q);
+        assert(sameResults(serial.onlineMatch(query, Word("keywords")), parallel.onlineMatch(query, Word("keywords"))));
+    }
+    assert(serial.match("about").size() > 0);
+}
+
+static void streamCorpus(Matcher &m, const Corpus &c) {
+    for(size_t i=0; i<c.size(); i++) {
+        const Document &d = c.getDocument(i);
+        WordList fieldNames;
+        d.getFieldNames(fieldNames);
+        for(size_t fi=0; fi<fieldNames.size(); fi++) {
+            const WordList &words = d.getText(fieldNames[fi]);
+            string text;
+            for(size_t wi=0; wi<words.size(); wi++) {
+                text += words[wi].asUtf8();
+                text += "  ";
+            }
+            m.addText(d.getID(), fieldNames[fi], text);
+        }
+    }
+}
+
+void testStreaming() {
+    Corpus *c1 = multiFieldCorpus(0, 1000);
+    Corpus *c2 = multiFieldCorpus(5000, 300);
+    Matcher indexed;
+    Matcher streamed;
+    const char *queries[] = {"opne", "save print", "zom windw help", "redo undo copy paste", "about"};
+
+    streamed.commit();
+    streamed.setThreadCount(2);
+    indexed.index(*c1);
+    streamCorpus(streamed, *c1);
+    assert(streamed.match("about").size() == 0);
+    streamed.commit();
+    for(const auto q : queries) {
+        assert(sameResults(indexed.match(q), streamed.match(q)));
+    }
+    indexed.index(*c2);
+    streamCorpus(streamed, *c2);
+    streamed.commit();
+    streamed.commit();
+    delete c1;
+    delete c2;
+    for(const auto q : queries) {
+        WordList query = splitToWords(q);
+        assert(sameResults(indexed.match(q), streamed.match(q)));
+        assert(sameResults(indexed.onlineMatch(query, Word("title")), streamed.onlineMatch(query, Word("title"))));
+    }
+    assert(streamed.match("about").size() > 0);
+}
+
+typedef void (Matcher::*PackingSetter)(const bool);
+
+static void checkPackedIndexes(PackingSetter setPacking) {
+    char dirTemplate[] = "/tmp/columbus_snapshot_XXXXXX";
+    char *dirName = mkdtemp(dirTemplate);
+    assert(dirName);
+    string snapshotDir = string(dirName) + "/snapshot";
+    Corpus *c1 = multiFieldCorpus(0, 500);
+    Corpus *c2 = multiFieldCorpus(5000, 100);
+    Matcher normal;
+    Matcher packed;
+    Matcher loaded;
+    const char *queries[] = {"opne", "save print", "zom windw help", "redo undo copy paste", "about"};
+
+    (packed.*setPacking)(true);
+    normal.index(*c1);
+    packed.index(*c1);
+    packed.saveSnapshot(snapshotDir);
+    loaded.loadSnapshot(snapshotDir);
+    for(const auto q : queries) {
+        WordList query = splitToWords(q);
+        assert(sameResults(normal.match(q), packed.match(q)));
+        assert(sameResults(normal.match(q), loaded.match(q)));
+        assert(sameResults(normal.onlineMatch(query, Word("title")), packed.onlineMatch(query, Word("title"))));
+    }
+    // Indexing more expands the indexes again.
+    normal.index(*c2);
+    loaded.index(*c2);
+    delete c1;
+    delete c2;
+    for(const auto q : queries) {
+        assert(sameResults(normal.match(q), loaded.match(q)));
+    }
+    removeDirectory(snapshotDir);
+    rmdir(dirName);
+}
+
+void testPackedIndexes() {
+    Matcher m;
+    assert(!m.getSuccinctTries());
+    assert(!m.getMinimizedIndexes());
+    m.setSuccinctTries(true);
+    m.setMinimizedIndexes(true);
+    assert(m.getSuccinctTries());
+    assert(m.getMinimizedIndexes());
+    checkPackedIndexes(&Matcher::setSuccinctTries);
+    checkPackedIndexes(&Matcher::setMinimizedIndexes);
+}
+
+void testTieOrder() {
+    const DocumentID ids[] = {5, 3, 9, 1, 7};
+    Word field("name");
+    Corpus c;
+    Matcher m;
+    for(const auto id : ids) {
+        Document d(id);
+        d.addText(field, "foo");
+        c.addDocument(d);
+    }
+    m.index(c);
+    Corpus more;
+    Document d(4);
+    d.addText(field, "foo");
+    more.addDocument(d);
+    m.index(more);
+
+    // Equally relevant documents come in increasing ID order no matter
+    // which order they were indexed in.
+    MatchResults r = m.match("foo");
+    assert(r.size() == 6);
+    for(size_t i=1; i<r.size(); i++) {
+        assert(r.getRelevancy(i) == r.getRelevancy(0));
+        assert(r.getDocumentID(i-1) < r.getDocumentID(i));
+    }
+}
+
+static void typeQuery(const Matcher &m, QuerySession &session, const string &text) {
+    for(size_t i=1; i<=text.size(); i++) {
+        WordList query = splitToWords(text.substr(0, i).c_str());
+        MatchResults expected = m.onlineMatch(query, Word("title"));
+        MatchResults result = m.onlineMatch(query, Word("title"), session);
+        assert(sameResults(expected, result));
+    }
+}
+
+void testQuerySession() {
+    Corpus *c = multiFieldCorpus(0, 300);
+    Matcher m;
+    QuerySession session;
+    m.index(*c);
+    delete c;
+    typeQuery(m, session, "save prnit previw");
+    // Starting over with a different query.
+    typeQuery(m, session, "zom windw");
+    typeQuery(m, session, "zom windw help");
+
+    // Reindexing must not leave stale searches behind.
+    c = multiFieldCorpus(300, 100);
+    m.index(*c);
+    delete c;
+    typeQuery(m, session, "zom windw help abot");
+
+    m.setThreadCount(3);
+    session.reset();
+    typeQuery(m, session, "redo undo copy paste");
+}
+
+static bool isPrefix(const MatchResults &prefix, const MatchResults &all) {
+    if(prefix.size() > all.size())
+        return false;
+    for(size_t i=0; i<prefix.size(); i++) {
+        if(prefix.getDocumentID(i) != all.getDocumentID(i) ||
+                prefix.getRelevancy(i) != all.getRelevancy(i))
+            return false;
+    }
+    return true;
+}
+
+void testMaxResults() {
+    Corpus *c = multiFieldCorpus(0, 500);
+    Matcher m;
+    const char *queries[] = {"opne", "save print", "zom windw help", "xyz"};
+    const size_t limits[] = {1, 3, 10, 100, 10000};
+    m.index(*c);
+    delete c;
+    for(const auto q : queries) {
+        SearchParameters all, filtered, filteredAll;
+        filtered.getResultFilter().addNewSubTerm(Word("title"), Word("save"));
+        filteredAll.getResultFilter().addNewSubTerm(Word("title"), Word("save"));
+        MatchResults allResults = m.match(q, all);
+        MatchResults allFiltered = m.match(q, filteredAll);
+        for(const auto limit : limits) {
+            SearchParameters limited;
+            limited.setMaxResults(limit);
+            assert(limited.getMaxResults() == limit);
+            MatchResults r = m.match(q, limited);
+            assert(r.size() == min(limit, allResults.size()));
+            assert(isPrefix(r, allResults));
+
+            filtered.setMaxResults(limit);
+            r = m.match(q, filtered);
+            assert(r.size() == min(limit, allFiltered.size()));
+            assert(isPrefix(r, allFiltered));
+        }
+    }
+}
+
+static void concurrentQueries(const Matcher &m) {
+    const char *queries[] = {"opne", "save print", "zom windw help", "redo undo copy paste", "about"};
+    vector<MatchResults> expected;
+    vector<MatchResults> expectedOnline;
+    for(const auto q : queries) {
+        expected.push_back(m.match(q));
+        expectedOnline.push_back(m.onlineMatch(splitToWords(q), Word("title")));
+    }
+    // MatchResults sorts itself on first access, so do that before sharing.
+    for(size_t i=0; i<expected.size(); i++) {
+        assert(sameResults(expected[i], expected[i]));
+        assert(sameResults(expectedOnline[i], expectedOnline[i]));
+    }
+    atomic<bool> ok(true);
+    vector<thread> threads;
+    for(int t=0; t<4; t++) {
+        threads.push_back(thread([&]() {
+            for(int round=0; round<5; round++) {
+                for(size_t i=0; i<expected.size(); i++) {
+                    if(!sameResults(expected[i], m.match(queries[i])) ||
+                            !sameResults(expectedOnline[i], m.onlineMatch(splitToWords(queries[i]), Word("title"))))
+                        ok = false;
+                }
+            }
+        }));
+    }
+    for(auto &t : threads)
+        t.join();
+    assert(ok);
+}
+
+void testConcurrentQueries() {
+    Corpus *c = multiFieldCorpus(0, 300);
+    Matcher m;
+    m.index(*c);
+    delete c;
+    concurrentQueries(m);
+    // Concurrent queries also share the matcher's thread pool.
+    m.setThreadCount(3);
+    concurrentQueries(m);
+
+    // Filtering on unknown words must not modify the matcher.
+    const Matcher &constMatcher = m;
+    SearchParameters params;
+    ResultFilter &filter = params.getResultFilter();
+    filter.addNewSubTerm(Word("nosuchfield"), Word("nosuchword"));
+    assert(constMatcher.match("save", params).size() == 0);
+}
+
+static void checkTotal(const MemoryUsage &usage) {
+    size_t sum = 0;
+    for(size_t i=0; i<usage.numComponents(); i++)
+        sum += usage.getComponentBytes(i);
+    assert(sum == usage.getTotal());
+}
+
+void testMemoryUsage() {
+    Corpus *c1 = multiFieldCorpus(0, 200);
+    Corpus *c2 = multiFieldCorpus(1000, 2000);
+    Matcher m;
+
+    MemoryUsage empty = m.memoryUsage();
+    checkTotal(empty);
+    assert(empty.numIndexes() == 0);
+
+    m.index(*c1);
+    MemoryUsage small = m.memoryUsage();
+    checkTotal(small);
+    assert(small.numIndexes() == 3);
+    assert(small.getIndexField(0) == Word("description"));
+    assert(small.getIndexField(1) == Word("keywords"));
+    assert(small.getIndexField(2) == Word("title"));
+    size_t indexSum = 0;
+    for(size_t i=0; i<small.numIndexes(); i++) {
+        assert(small.getIndexBytes(i) > 0);
+        indexSum += small.getIndexBytes(i);
+    }
+    assert(small.getComponentName(1) == "field indexes");
+    assert(small.getComponentBytes(1) == indexSum);
+    assert(small.getTotal() > empty.getTotal());
+
+    streamCorpus(m, *c2);
+    MemoryUsage pending = m.memoryUsage();
+    checkTotal(pending);
+    assert(pending.getComponentName(pending.numComponents()-1) == "pending text");
+    m.commit();
+    MemoryUsage large = m.memoryUsage();
+    checkTotal(large);
+    assert(large.numComponents() == small.numComponents());
+    assert(large.getTotal() > small.getTotal());
+    delete c1;
+    delete c2;
+
+    try {
+        large.getIndexBytes(large.numIndexes());
+        assert(false);
+    } catch(const std::out_of_range &e) {
+    }
+}
+
 int main(int /*argc*/, char **/*argv*/) {
     try {
         testMatcher();
         testRelevancy();
+        testStreaming();
         testMultiWord();
         testSentence();
         testExactOrder();
@@ -302,6 +779,15 @@ int main(int /*argc*/, char **/*argv*/) {
         emptyMatch();
         testMatchCount();
         testPerfect();
+        testSnapshot();
+        testThreads();
+        testParallelBuild();
+        testPackedIndexes();
+        testConcurrentQueries();
+        testMaxResults();
+        testTieOrder();
+        testQuerySession();
+        testMemoryUsage();
     } catch(const std::exception &e) {
         fprintf(stderr, "Fail: %s\n", e.what());
         return 666;
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file tests the internal posting list.
+ */
+
+#include "PostingList.hh"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace Columbus;
+using namespace std;
+
+static vector<DocumentID> contents(const PostingList &l) {
+    vector<DocumentID> result;
+    for(PostingList::Iterator it = l.begin(); !it.atEnd(); it.next())
+        result.push_back(it.get());
+    return result;
+}
+
+void testEmpty() {
+    PostingList l;
+    assert(l.size() == 0);
+    assert(!l.contains(0));
+    assert(l.begin().atEnd());
+    l.finalize();
+    assert(l.size() == 0);
+    assert(l.begin().atEnd());
+}
+
+void testInOrder() {
+    PostingList l;
+    vector<DocumentID> expected;
+    for(DocumentID i=0; i<1000; i++) {
+        DocumentID id = i*i*7;
+        l.add(id);
+        l.add(id); // Duplicates are ignored.
+        expected.push_back(id);
+    }
+    assert(l.size() == expected.size());
+    assert(contents(l) == expected);
+    assert(l.contains(7*999*999));
+    assert(!l.contains(8));
+    l.finalize();
+    assert(contents(l) == expected);
+    for(const auto &i : expected)
+        assert(l.contains(i));
+    assert(!l.contains(1));
+    assert(!l.contains(7*999*999 + 1));
+}
+
+void testOutOfOrder() {
+    PostingList l;
+    set<DocumentID> expected;
+    srand(42);
+    for(int i=0; i<5000; i++) {
+        DocumentID id = rand() % 20000;
+        l.add(id);
+        expected.insert(id);
+        assert(l.contains(id));
+    }
+    bool thrown = false;
+    try {
+        l.begin();
+    } catch(const logic_error &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    l.finalize();
+    assert(l.size() == expected.size());
+    assert(contents(l) == vector<DocumentID>(expected.begin(), expected.end()));
+    for(DocumentID i=0; i<20000; i++)
+        assert(l.contains(i) == (expected.find(i) != expected.end()));
+
+    // Adding after finalizing still works.
+    l.add(3);
+    l.add(100000);
+    expected.insert(3);
+    expected.insert(100000);
+    assert(l.contains(3));
+    assert(l.contains(100000));
+    l.finalize();
+    assert(contents(l) == vector<DocumentID>(expected.begin(), expected.end()));
+}
+
+void testSkipTo() {
+    PostingList l;
+    for(DocumentID i=0; i<10000; i++)
+        l.add(3*i);
+    l.finalize();
+    PostingList::Iterator it = l.begin();
+    it.skipTo(0);
+    assert(it.get() == 0);
+    it.skipTo(301);
+    assert(it.get() == 303);
+    it.skipTo(303);
+    assert(it.get() == 303);
+    it.skipTo(200); // Never moves backwards.
+    assert(it.get() == 303);
+    it.skipTo(15000);
+    assert(it.get() == 15000);
+    it.next();
+    assert(it.get() == 15003);
+    it.skipTo(3*9999);
+    assert(!it.atEnd());
+    assert(it.get() == 3*9999);
+    it.skipTo(3*9999 + 1);
+    assert(it.atEnd());
+}
+
+void testIntersect() {
+    PostingList a, b;
+    vector<DocumentID> expected;
+    for(DocumentID i=0; i<20000; i++) {
+        if(i % 2 == 0)
+            a.add(i);
+        if(i % 301 == 0)
+            b.add(i);
+        if(i % 2 == 0 && i % 301 == 0)
+            expected.push_back(i);
+    }
+    a.finalize();
+    b.finalize();
+    vector<DocumentID> result;
+    PostingList::intersect(a, b, [&result](DocumentID id) { result.push_back(id); });
+    assert(result == expected);
+    result.clear();
+    PostingList::intersect(b, a, [&result](DocumentID id) { result.push_back(id); });
+    assert(result == expected);
+}
+
+void testCopy() {
+    PostingList a;
+    for(DocumentID i=500; i>0; i--)
+        a.add(i*11);
+    PostingList b(a);
+    a.finalize();
+    b.finalize();
+    assert(contents(a) == contents(b));
+    PostingList c;
+    c.add(1);
+    c = a;
+    assert(contents(c) == contents(a));
+    PostingList d(std::move(c));
+    assert(contents(d) == contents(a));
+    assert(d.memoryUsage() > sizeof(PostingList));
+}
+
+int main(int /*argc*/, char **/*argv*/) {
+    try {
+        testEmpty();
+        testInOrder();
+        testOutOfOrder();
+        testSkipTo();
+        testIntersect();
+        testCopy();
+    } catch(const std::exception &e) {
+        fprintf(stderr, "Fail: %s\n", e.what());
+        return 666;
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file checks that all row kernels the CPU supports give the
+ * same errors as a straightforward evaluation of the error matrix.
+ */
+
+#include "RowKernel.hh"
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace Columbus;
+using namespace std;
+
+static const size_t MAX_LENGTH = 40;
+static const size_t LUT_LETTERS = 16;
+
+static unsigned int nextRandom(unsigned int &seed) {
+    seed = seed*1103515245 + 12345;
+    return seed >> 16;
+}
+
+static void referenceRow(const ErrorRowInput &in, int *row) {
+    for(size_t i=1; i<=in.queryLength; i++) {
+        int best = row[i-1] + in.insertionError;
+        if(i >= in.queryLength)
+            best = min(best, in.previous[i] + in.endDeletionError);
+        else
+            best = min(best, in.previous[i] + in.deletionError);
+        best = min(best, in.previous[i-1] + in.substituteErrors[i-1]);
+        if(in.beforePrevious && i > 1 && in.query[i-1] == in.previousLetter && in.query[i-2] == in.letter)
+            best = min(best, in.beforePrevious[i-2] + in.transposeError);
+        row[i] = best;
+    }
+}
+
+void testKernels() {
+    unsigned int seed = 1234;
+    vector<int> lut(LUT_LETTERS);
+    vector<int> previous(MAX_LENGTH+1), beforePrevious(MAX_LENGTH+1), subs(MAX_LENGTH);
+    vector<Letter> query(MAX_LENGTH);
+    const RowKernelType types[] = {SCALAR_ROW_KERNEL, SSE41_ROW_KERNEL, AVX2_ROW_KERNEL};
+
+    assert(getErrorRowFunction(SCALAR_ROW_KERNEL));
+    assert(getErrorRowFunction(bestRowKernel()));
+    for(int round=0; round<2000; round++) {
+        ErrorRowInput in;
+        const size_t length = round % (MAX_LENGTH+1);
+        for(size_t i=0; i<LUT_LETTERS; i++)
+            lut[i] = nextRandom(seed) % 200;
+        for(size_t i=0; i<=length; i++) {
+            previous[i] = nextRandom(seed) % 1000;
+            beforePrevious[i] = nextRandom(seed) % 1000;
+        }
+        // Only a few letters so transpositions come up often.
+        for(size_t i=0; i<length; i++)
+            query[i] = 'a' + nextRandom(seed) % 3;
+        in.letter = 'a' + nextRandom(seed) % 3;
+        in.previousLetter = 'a' + nextRandom(seed) % 3;
+        for(size_t i=0; i<length; i++)
+            subs[i] = lut[query[i] - 'a'];
+        in.previous = previous.data();
+        in.beforePrevious = round % 5 == 0 ? nullptr : beforePrevious.data();
+        in.substituteErrors = subs.data();
+        in.query = query.data();
+        in.queryLength = length;
+        in.insertionError = 1 + nextRandom(seed) % 150;
+        in.deletionError = 1 + nextRandom(seed) % 150;
+        in.endDeletionError = 1 + nextRandom(seed) % 150;
+        in.transposeError = nextRandom(seed) % 150;
+
+        vector<int> expected(length+1);
+        expected[0] = nextRandom(seed) % 1000;
+        referenceRow(in, expected.data());
+        for(const auto type : types) {
+            ErrorRowFunction f = getErrorRowFunction(type);
+            if(!f)
+                continue;
+            vector<int> row(length+1);
+            row[0] = expected[0];
+            f(in, row.data());
+            assert(row == expected);
+        }
+    }
+}
+
+void testGather() {
+    vector<int> lut(LUT_LETTERS);
+    vector<Letter> letters;
+    const RowKernelType types[] = {SCALAR_ROW_KERNEL, SSE41_ROW_KERNEL, AVX2_ROW_KERNEL};
+
+    for(size_t i=0; i<LUT_LETTERS; i++)
+        lut[i] = 3*i + 1;
+    for(size_t i=0; i<MAX_LENGTH; i++)
+        letters.push_back((7*i) % LUT_LETTERS);
+    for(const auto type : types) {
+        SubstituteGatherFunction f = getSubstituteGatherFunction(type);
+        if(!f)
+            continue;
+        for(size_t length=0; length<=MAX_LENGTH; length++) {
+            vector<int> errors(length);
+            assert(f(lut.data(), LUT_LETTERS, letters.data(), length, errors.data()));
+            for(size_t i=0; i<length; i++)
+                assert(errors[i] == lut[letters[i]]);
+        }
+        vector<Letter> outside(letters);
+        outside[MAX_LENGTH-3] = LUT_LETTERS;
+        vector<int> errors(MAX_LENGTH);
+        assert(!f(lut.data(), LUT_LETTERS, outside.data(), MAX_LENGTH, errors.data()));
+    }
+}
+
+int main(int /*argc*/, char **/*argv*/) {
+    try {
+        testKernels();
+        testGather();
+    } catch(const std::exception &e) {
+        fprintf(stderr, "Fail: %s\n", e.what());
+        return 666;
+    }
+    return 0;
+}
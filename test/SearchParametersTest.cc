@@ -23,6 +23,8 @@
 #include"Document.hh"
 #include"Corpus.hh"
 #include"MatchResults.hh"
+#include"QueryStats.hh"
+#include"ResultFilter.hh"
 #include<cassert>
 
 using namespace Columbus;
@@ -79,8 +81,110 @@ void testNosearchMatching() {
     assert(r.getDocumentID(0) == 1);
 }
 
+void testMaxResults() {
+    SearchParameters sp;
+    assert(sp.getMaxResults() == 0);
+    sp.setMaxResults(10);
+    assert(sp.getMaxResults() == 10);
+    sp.setMaxResults(0);
+    assert(sp.getMaxResults() == 0);
+}
+
+void testLastWordPrefix() {
+    Word field("name");
+    Corpus c;
+    Matcher m;
+    SearchParameters sp;
+    Document d1(1);
+    Document d2(2);
+    d1.addText(field, "print preview");
+    d2.addText(field, "save");
+    c.addDocument(d1);
+    c.addDocument(d2);
+    m.index(c);
+
+    assert(!sp.isLastWordPrefix());
+    assert(m.match("prev", sp).size() == 0);
+    sp.setLastWordPrefix(true);
+    assert(sp.isLastWordPrefix());
+    MatchResults r = m.match("prev", sp);
+    assert(r.size() == 1);
+    assert(r.getDocumentID(0) == 1);
+    // Only the last word is a prefix.
+    r = m.match("prev save", sp);
+    assert(r.size() == 1);
+    assert(r.getDocumentID(0) == 2);
+    assert(m.match("pri", sp).size() == 1);
+    assert(m.match("sa", sp).getDocumentID(0) == 2);
+}
+
+void testQueryStats() {
+    Word title("title");
+    Word keywords("keywords");
+    Corpus c;
+    Matcher m;
+    SearchParameters sp;
+    QueryStats stats;
+    Document d1(1);
+    Document d2(2);
+    Document d3(3);
+    d1.addText(title, "print preview");
+    d1.addText(keywords, "paper");
+    d2.addText(title, "print");
+    d2.addText(keywords, "printer");
+    d3.addText(title, "save");
+    d3.addText(keywords, "disk");
+    c.addDocument(d1);
+    c.addDocument(d2);
+    c.addDocument(d3);
+    m.index(c);
+
+    assert(sp.getQueryStats() == nullptr);
+    sp.setQueryStats(&stats);
+    assert(sp.getQueryStats() == &stats);
+    MatchResults r = m.match("prnt", sp);
+    assert(r.size() == 2);
+    assert(stats.getNodesVisited() > 0);
+    assert(stats.getNodesVisited() == stats.getNodesVisited(title) + stats.getNodesVisited(keywords));
+    assert(stats.getNodesVisited(Word("nosuchfield")) == 0);
+    assert(stats.getCellsComputed() >= stats.getNodesVisited());
+    // Only "print" is close enough, and it is in two titles.
+    assert(stats.getCandidateWords(Word("prnt")) == 1);
+    assert(stats.getCandidateWords(Word("save")) == 0);
+    assert(stats.getPostingsScanned() == 2);
+    assert(stats.getDocumentsScored() == 2);
+    assert(stats.getDocumentsFiltered() == 0);
+    assert(stats.getIndexMatchTime() >= 0);
+    assert(stats.getGatherTime() >= 0);
+    assert(stats.getResultTime() >= 0);
+
+    stats.clear();
+    assert(stats.getNodesVisited() == 0);
+    assert(stats.getCandidateWords(Word("prnt")) == 0);
+    sp.getResultFilter().addNewSubTerm(keywords, Word("paper"));
+    r = m.match("prnt", sp);
+    assert(r.size() == 1);
+    assert(stats.getDocumentsScored() == 2);
+    assert(stats.getDocumentsFiltered() == 1);
+    stats.clear();
+    sp.setMaxResults(1);
+    r = m.match("prnt", sp);
+    assert(r.size() == 1);
+    // Document 2 can not beat document 1, so it never reaches the filter.
+    assert(stats.getDocumentsScored() == 2);
+    assert(stats.getDocumentsFiltered() == 0);
+
+    sp.setQueryStats(nullptr);
+    stats.clear();
+    m.match("prnt", sp);
+    assert(stats.getNodesVisited() == 0);
+}
+
 int main(int /*argc*/, char **/*argv*/) {
     testDynamic();
+    testMaxResults();
+    testLastWordPrefix();
     testNosearch();
     testNosearchMatching();
+    testQueryStats();
 }
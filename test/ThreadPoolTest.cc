@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file tests the internal thread pool.
+ */
+
+#include "ThreadPool.hh"
+#include <cassert>
+#include <cstdio>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Columbus;
+using namespace std;
+
+class CountingTask final : public ThreadTask {
+public:
+    vector<atomic<int> > counts;
+    size_t numWorkers;
+    atomic<bool> badWorker;
+
+    CountingTask(const size_t numTasks, const size_t numWorkers_) :
+        counts(numTasks), numWorkers(numWorkers_), badWorker(false) {
+        for(auto &c : counts)
+            c = 0;
+    }
+
+    void execute(const size_t task, const size_t worker) override {
+        if(worker >= numWorkers)
+            badWorker = true;
+        counts[task]++;
+    }
+
+    bool allOnce() const {
+        for(const auto &c : counts) {
+            if(c != 1)
+                return false;
+        }
+        return !badWorker;
+    }
+};
+
+class FailingTask final : public ThreadTask {
+public:
+    void execute(const size_t task, const size_t /*worker*/) override {
+        if(task == 5)
+            throw runtime_error("Task failed.");
+    }
+};
+
+void testRun() {
+    for(size_t threads=1; threads<=4; threads++) {
+        ThreadPool pool(threads);
+        assert(pool.size() == threads);
+        for(size_t numTasks=0; numTasks<50; numTasks+=7) {
+            CountingTask t(numTasks, threads);
+            pool.run(t, numTasks);
+            assert(t.allOnce());
+        }
+    }
+}
+
+void testException() {
+    ThreadPool pool(3);
+    FailingTask t;
+    bool failed = false;
+    try {
+        pool.run(t, 100);
+    } catch(const runtime_error &e) {
+        failed = true;
+    }
+    assert(failed);
+    // The pool must still work afterwards.
+    CountingTask c(20, 3);
+    pool.run(c, 20);
+    assert(c.allOnce());
+}
+
+void testConcurrentCallers() {
+    ThreadPool pool(3);
+    vector<thread> callers;
+    atomic<bool> ok(true);
+    for(int i=0; i<4; i++) {
+        callers.push_back(thread([&pool, &ok]() {
+            for(int round=0; round<50; round++) {
+                CountingTask t(30, 3);
+                pool.run(t, 30);
+                if(!t.allOnce())
+                    ok = false;
+            }
+        }));
+    }
+    for(auto &t : callers)
+        t.join();
+    assert(ok);
+}
+
+int main(int /*argc*/, char **/*argv*/) {
+    try {
+        testRun();
+        testException();
+        testConcurrentCallers();
+    } catch(const std::exception &e) {
+        fprintf(stderr, "Fail: %s\n", e.what());
+        return 666;
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file tests the single pass tokenizer.
+ */
+
+#include "Tokenizer.hh"
+#include "Word.hh"
+#include "WordList.hh"
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace Columbus;
+using namespace std;
+
+void testSpans() {
+    Tokenizer t;
+    t.tokenize("  Abc\tdéf\n\rghij  ");
+    assert(t.size() == 3);
+    assert(t[0].offset == 2);
+    assert(t[0].length == 3);
+    assert(t[1].offset == 6);
+    assert(t[1].length == 3);
+    assert(t[2].offset == 11);
+    assert(t[2].length == 4);
+    assert(t.letters()[2] == 'a');
+    assert(t.word(0) == "abc");
+    assert(t.word(1) == "déf");
+    assert(t.word(2) == "ghij");
+
+    bool gotException = false;
+    try {
+        t[3];
+    } catch(out_of_range &e) {
+        gotException = true;
+    }
+    assert(gotException);
+}
+
+void testReuse() {
+    Tokenizer t;
+    t.tokenize("a very long first document with many words in it");
+    assert(t.size() == 10);
+    t.tokenize("short");
+    assert(t.size() == 1);
+    assert(t.word(0) == "short");
+    t.tokenize("");
+    assert(t.size() == 0);
+    t.tokenize(" \t ");
+    assert(t.size() == 0);
+}
+
+void testSplitChars() {
+    Tokenizer t;
+    WordList list;
+    const Letter splitChars[] = {',', 0xe4};
+    t.tokenize("ab,cdäef", splitChars, 2);
+    t.appendTo(list);
+    assert(list.size() == 3);
+    assert(list[0] == "ab");
+    assert(list[1] == "cd");
+    assert(list[2] == "ef");
+}
+
+int main(int /*argc*/, char **/* argv*/) {
+    try {
+        testSpans();
+        testReuse();
+        testSplitChars();
+    } catch(const exception &e) {
+        fprintf(stderr, "Fail: %s\n", e.what());
+        return 666;
+    }
+    return 0;
+}
@@ -20,8 +20,15 @@
 #include "Word.hh"
 #include "Trie.hh"
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+#include <string>
+#include <vector>
 
 using namespace Columbus;
+using namespace std;
 
 void testWordBuilding() {
     Trie t;
@@ -64,10 +71,275 @@ void testHas() {
     assert(!t.hasWord(w4));
 }
 
+void testSaveLoad() {
+    char fname[] = "/tmp/columbus_trietest_XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+    Word w1("abc");
+    Word w2("abd");
+    Word w3("x");
+    TrieOffset node1;
+    {
+        Trie t;
+        node1 = t.insertWord(w1, 1);
+        t.insertWord(w2, 2);
+        t.save(fname);
+    }
+
+    Trie loaded;
+    loaded.openReadOnly(fname);
+    assert(loaded.isReadOnly());
+    assert(loaded.numWords() == 2);
+    assert(loaded.hasWord(w1));
+    assert(loaded.hasWord(w2));
+    assert(!loaded.hasWord(w3));
+    assert(loaded.getWord(node1) == w1);
+    assert(loaded.getWordID(loaded.findWord(w2)) == 2);
+
+    // Modifying must not change the file.
+    loaded.insertWord(w3, 3);
+    assert(!loaded.isReadOnly());
+    assert(loaded.hasWord(w3));
+    assert(loaded.numWords() == 3);
+
+    Trie reloaded;
+    reloaded.openReadOnly(fname);
+    assert(reloaded.numWords() == 2);
+    assert(!reloaded.hasWord(w3));
+
+    // Saving over the file a trie is mapped from leaves that trie intact.
+    loaded.save(fname);
+    reloaded.save(fname);
+    assert(reloaded.isReadOnly());
+    assert(reloaded.numWords() == 2);
+    assert(reloaded.getWordID(reloaded.findWord(w2)) == 2);
+    Trie again;
+    again.openReadOnly(fname);
+    assert(again.numWords() == 2);
+    unlink(fname);
+}
+
+void testLoadGarbage() {
+    char fname[] = "/tmp/columbus_trietest_XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    const char garbage[] = "this is not a trie file, not even close to being one";
+    assert(write(fd, garbage, sizeof(garbage)) == sizeof(garbage));
+    close(fd);
+    Trie t;
+    bool failed = false;
+    try {
+        t.openReadOnly(fname);
+    } catch(const std::runtime_error &e) {
+        failed = true;
+    }
+    assert(failed);
+    assert(!t.isReadOnly());
+    unlink(fname);
+}
+
+// Tries built with the other large_tries setting must be refused.
+void testOffsetSize() {
+    char fname[] = "/tmp/columbus_trietest_XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+    {
+        Trie t;
+        t.insertWord(Word("abc"), 1);
+        t.save(fname);
+    }
+    // The offset width follows the magic, version, byte order and letter size.
+    const uint32_t otherSize = sizeof(TrieOffset) == 4 ? 8 : 4;
+    FILE *f = fopen(fname, "r+b");
+    assert(f);
+    assert(fseek(f, 20, SEEK_SET) == 0);
+    assert(fwrite(&otherSize, sizeof(otherSize), 1, f) == 1);
+    fclose(f);
+    Trie t;
+    string msg;
+    try {
+        t.openReadOnly(fname);
+    } catch(const std::runtime_error &e) {
+        msg = e.what();
+    }
+    assert(msg.find("offset size") != string::npos);
+    assert(!t.isReadOnly());
+    unlink(fname);
+}
+
+void testFreeze() {
+    const char *words[] = {"abc", "abd", "ab", "x", "xyz", "b", "bca", "abcd", "zzz", "aaa"};
+    const size_t numWords = sizeof(words)/sizeof(words[0]);
+    Trie t;
+    for(size_t i=0; i<numWords; i++)
+        t.insertWord(Word(words[i]), i);
+    const size_t numNodes = t.numNodes();
+    assert(!t.isFrozen());
+    t.freeze();
+    assert(t.isFrozen());
+    assert(t.numWords() == numWords);
+    assert(t.numNodes() == numNodes);
+    for(size_t i=0; i<numWords; i++) {
+        Word w(words[i]);
+        TrieOffset node = t.findWord(w);
+        assert(node);
+        assert(t.getWordID(node) == i);
+        assert(t.getWord(node) == w);
+    }
+    assert(!t.hasWord(Word("a")));
+    assert(!t.hasWord(Word("abce")));
+    assert(!t.hasWord(Word("y")));
+
+    // Children come right after their parent, in letter order.
+    TrieOffset node = t.findWord(Word("ab"));
+    TrieOffset sibling = t.getSiblingList(node);
+    assert(sibling > node && t.getNextSibling(sibling) > sibling);
+    assert(t.getLetter(sibling) == 'c');
+    assert(t.getLetter(t.getNextSibling(sibling)) == 'd');
+    assert(!t.hasSibling(t.getNextSibling(sibling)));
+
+    // Words that only need existing nodes keep the trie frozen.
+    t.insertWord(Word("a"), numWords);
+    assert(t.isFrozen());
+    assert(t.hasWord(Word("a")));
+    t.insertWord(Word("abe"), numWords+1);
+    assert(!t.isFrozen());
+    assert(t.hasWord(Word("abe")));
+    assert(t.hasWord(Word("abc")));
+    t.freeze();
+    assert(t.getWord(t.findWord(Word("abe"))) == Word("abe"));
+
+    char fname[] = "/tmp/columbus_trietest_XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+    t.save(fname);
+    Trie reloaded;
+    reloaded.openReadOnly(fname);
+    assert(reloaded.isFrozen());
+    for(size_t i=0; i<numWords; i++)
+        assert(reloaded.hasWord(Word(words[i])));
+    unlink(fname);
+}
+
+static void compareTries(const Trie &t1, const TrieOffset n1, const Trie &t2, const TrieOffset n2) {
+    assert(t1.getWordID(n1) == t2.getWordID(n2));
+    TrieOffset s1 = t1.getSiblingList(n1);
+    TrieOffset s2 = t2.getSiblingList(n2);
+    while(s1 && s2) {
+        assert(t1.getLetter(s1) == t2.getLetter(s2));
+        assert(t1.hasSibling(s1) == t2.hasSibling(s2));
+        assert(t2.getParent(t2.getChild(s2)) == n2);
+        assert(t2.getSiblingTo(n2, t2.getChild(s2)) == s2);
+        compareTries(t1, t1.getChild(s1), t2, t2.getChild(s2));
+        s1 = t1.getNextSibling(s1);
+        s2 = t2.getNextSibling(s2);
+    }
+    assert(!s1 && !s2);
+}
+
+void testSuccinct() {
+    const char letters[] = "abcdef";
+    unsigned int seed = 5;
+    vector<Word> words;
+    Trie frozen;
+    Trie t;
+    for(WordID i=0; i<2000; i++) {
+        string w;
+        seed = seed*1103515245 + 12345;
+        size_t length = 1 + (seed >> 16) % 8;
+        for(size_t j=0; j<length; j++) {
+            seed = seed*1103515245 + 12345;
+            w += letters[(seed >> 16) % 6];
+        }
+        Word word(w.c_str());
+        if(t.hasWord(word))
+            continue;
+        frozen.insertWord(word, words.size());
+        t.insertWord(word, words.size());
+        words.push_back(word);
+    }
+    frozen.freeze();
+    const size_t numNodes = t.numNodes();
+    t.makeSuccinct();
+    assert(t.isSuccinct());
+    assert(t.isFrozen());
+    assert(t.numNodes() == numNodes);
+    assert(t.numWords() == words.size());
+    assert(t.getParent(t.getRoot()) == 0);
+    compareTries(frozen, frozen.getRoot(), t, t.getRoot());
+    for(size_t i=0; i<words.size(); i++) {
+        TrieOffset node = t.findWord(words[i]);
+        assert(node);
+        assert(t.getWordID(node) == i);
+        assert(t.getWord(node) == words[i]);
+    }
+    assert(!t.hasWord(Word("g")));
+    assert(!t.hasWord(Word("aaaaaaaaa")));
+
+    char fname[] = "/tmp/columbus_trietest_XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+    t.save(fname);
+    Trie reloaded;
+    reloaded.openReadOnly(fname);
+    unlink(fname);
+    assert(reloaded.isSuccinct());
+    compareTries(frozen, frozen.getRoot(), reloaded, reloaded.getRoot());
+
+    // Inserting expands it back into a normal trie.
+    reloaded.insertWord(Word("ggg"), words.size());
+    assert(!reloaded.isSuccinct());
+    assert(!reloaded.isReadOnly());
+    assert(reloaded.hasWord(Word("ggg")));
+    for(size_t i=0; i<words.size(); i++)
+        assert(reloaded.getWordID(reloaded.findWord(words[i])) == i);
+}
+
+/*
+ * Enough words to grow the backing map many times over. Everything
+ * inserted before a growth must still be found after it.
+ */
+void testGrowth() {
+    const size_t numWords = 20000;
+    Trie t;
+    size_t lastSize = t.memoryUsage();
+    size_t growths = 0;
+    for(size_t i=0; i<numWords; i++) {
+        string w = "word" + to_string(i*7919);
+        t.insertWord(Word(w.c_str()), i);
+        if(t.memoryUsage() != lastSize) {
+            assert(t.memoryUsage() == 2*lastSize);
+            lastSize = t.memoryUsage();
+            growths++;
+            for(size_t j=0; j<=i; j+=97) {
+                string old = "word" + to_string(j*7919);
+                assert(t.getWordID(t.findWord(Word(old.c_str()))) == j);
+            }
+        }
+    }
+    assert(growths >= 5);
+    assert(t.numWords() == numWords);
+    t.freeze();
+    for(size_t i=0; i<numWords; i++) {
+        string w = "word" + to_string(i*7919);
+        assert(t.getWordID(t.findWord(Word(w.c_str()))) == i);
+    }
+}
+
 int main(int /*argc*/, char **/*argv*/) {
     // Move basic tests from levtrietest here.
     testWordBuilding();
     testHas();
+    testSaveLoad();
+    testLoadGarbage();
+    testOffsetSize();
+    testFreeze();
+    testSuccinct();
+    testGrowth();
     return 0;
 }
 
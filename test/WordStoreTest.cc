@@ -20,7 +20,11 @@
 #include "WordStore.hh"
 #include "Word.hh"
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 #include <stdexcept>
+#include <unistd.h>
 
 using namespace Columbus;
 
@@ -54,9 +58,41 @@ void testStore() {
     assert(gotException);
 }
 
+void testSaveLoad() {
+    char fname[] = "/tmp/columbus_wordstore_XXXXXX";
+    int fd = mkstemp(fname);
+    assert(fd >= 0);
+    close(fd);
+    std::string basename(fname);
+    WordStore s;
+    WordStore loaded;
+    Word w1("abc");
+    Word w2("def");
+    Word w3("ghi");
+    WordID w1ID = s.getID(w1);
+    WordID w2ID = s.getID(w2);
+
+    s.save(basename);
+    loaded.load(basename);
+    assert(loaded.hasWord(w1));
+    assert(loaded.hasWord(w2));
+    assert(!loaded.hasWord(w3));
+    assert(loaded.getID(w1) == w1ID);
+    assert(loaded.getWord(w2ID) == w2);
+
+    WordID w3ID = loaded.getID(w3);
+    assert(w3ID != w1ID && w3ID != w2ID);
+    assert(loaded.getWord(w3ID) == w3);
+
+    unlink(fname);
+    unlink((basename + ".trie").c_str());
+    unlink((basename + ".ids").c_str());
+}
+
 int main(int /*argc*/, char **/*argv*/) {
     try {
         testStore();
+        testSaveLoad();
     } catch(const std::exception &e) {
         fprintf(stderr, "Fail: %s\n", e.what());
         return 666;
@@ -25,6 +25,7 @@
 #include <cassert>
 #include <stdexcept>
 #include <cstdio>
+#include <utility>
 #include "Word.hh"
 
 using namespace Columbus;
@@ -270,6 +271,38 @@ void testAutoLower() {
 
 }
 
+void testDecoding() {
+    // Long enough to go through the eight bytes at a time path.
+    Word ascii("ABCDEFGHIJKLMNOPQRSTUVWXYZ@[`{");
+    assert(ascii == "abcdefghijklmnopqrstuvwxyz@[`{");
+
+    const unsigned char mixed[] = {'X', 'Y', 'Z', 'W', 'V', 'U', 'T', 0xc3, 0x84,
+        0xe2, 0x82, 0xac, 0xd0, 0x96, 'Q', 0}; // "XYZWVUTÄ€ЖQ" in UTF-8.
+    const unsigned char mixedLower[] = {'x', 'y', 'z', 'w', 'v', 'u', 't', 0xc3, 0xa4,
+        0xe2, 0x82, 0xac, 0xd0, 0xb6, 'q', 0};
+    Word w((const char*)mixed);
+    assert(w.length() == 11);
+    assert(w[7] == 0xe4);
+    assert(w[8] == 0x20ac);
+    assert(w[9] == 0x436);
+    assert(w == (const char*)mixedLower);
+
+    const unsigned char truncated[] = {'a', 0xe2, 0x82, 0};
+    const unsigned char overlong[] = {0xc0, 0xaf, 0};
+    const unsigned char surrogate[] = {0xed, 0xa0, 0x80, 0};
+    const unsigned char stray[] = {'a', 0x80, 'b', 0};
+    const unsigned char *broken[] = {truncated, overlong, surrogate, stray};
+    for(size_t i=0; i<sizeof(broken)/sizeof(broken[0]); i++) {
+        bool gotException = false;
+        try {
+            Word b((const char*)broken[i]);
+        } catch(std::runtime_error &e) {
+            gotException = true;
+        }
+        assert(gotException);
+    }
+}
+
 void testJoin() {
     Word w1("abc");
     Word w2("def");
@@ -337,6 +370,44 @@ void testAssignment() {
     assert(gotAssertion);
 }
 
+void checkCopies(const char *txt) {
+    Word orig(txt);
+    Word copy(orig);
+    assert(copy == orig);
+    assert(copy == txt);
+
+    Word assigned("x");
+    assigned = orig;
+    assert(assigned == txt);
+    assigned = assigned;
+    assert(assigned == txt);
+
+    Word moved(std::move(copy));
+    assert(moved == txt);
+    assert(copy.length() == 0);
+    Word moveAssigned;
+    moveAssigned = std::move(moved);
+    assert(moveAssigned == txt);
+    assert(moved.length() == 0);
+
+    // Copies must not depend on the lifetime of the original.
+    {
+        Word temp(txt);
+        assigned = temp;
+    }
+    assert(assigned == txt);
+    assert(assigned.hash() == orig.hash());
+    assert(orig.join(orig).length() == 2*orig.length());
+}
+
+void testCopies() {
+    checkCopies("a");
+    checkCopies("short");
+    checkCopies("averyveryverylongword");
+    checkCopies("äiti");
+    checkCopies("äääääääääääääääääääääääääää");
+}
+
 int main(int /*argc*/, char **/* argv*/) {
     try {
         testEmpty();
@@ -348,8 +419,10 @@ int main(int /*argc*/, char **/* argv*/) {
         testEncoding2();
         testLessThan();
         testAutoLower();
+        testDecoding();
         testJoin();
         testAssignment();
+        testCopies();
     } catch(const exception &e) {
         fprintf(stderr, "Fail: %s\n", e.what());
         return 666;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 Canonical, Ltd.
+ *
+ * Authors:
+ *    Jussi Pakkanen <jussi.pakkanen@canonical.com>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of version 3 of the GNU Lesser General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Indexes every line of a file as a document and prints how much
+ * memory the matcher uses.
+ */
+
+#include "Matcher.hh"
+#include "MemoryUsage.hh"
+#include "Word.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Columbus;
+
+const size_t COMMIT_INTERVAL = 100000;
+
+void load_data(Matcher &m, char *file) {
+    FILE *f = fopen(file, "r");
+    char buffer[1024];
+    const Word field("name");
+    DocumentID id = 0;
+    if(!f) {
+        printf("Could not open file %s.\n", file);
+        exit(1);
+    }
+    while(fgets(buffer, 1024, f) != NULL) {
+        buffer[strcspn(buffer, "\n")] = '\0';
+        m.addText(id++, field, buffer);
+        if(id % COMMIT_INTERVAL == 0)
+            m.commit();
+    }
+    fclose(f);
+    m.commit();
+    printf("Indexed %lu lines.\n", (unsigned long) id);
+}
+
+void print_usage(const MemoryUsage &usage) {
+    const double mb = 1024.0*1024.0;
+    for(size_t i=0; i<usage.numComponents(); i++) {
+        printf("%-16s %10.2f MB\n", usage.getComponentName(i).c_str(), usage.getComponentBytes(i)/mb);
+    }
+    printf("%-16s %10.2f MB\n\n", "total", usage.getTotal()/mb);
+    for(size_t i=0; i<usage.numIndexes(); i++) {
+        printf("field %-10s %10.2f MB\n", usage.getIndexField(i).asUtf8().c_str(), usage.getIndexBytes(i)/mb);
+    }
+}
+
+int run_test(int argc, char **argv) {
+    Matcher m;
+    if(argc < 2) {
+        printf("%s datafile [succinct|minimized]\n", argv[0]);
+        return 0;
+    }
+    if(argc > 2) {
+        if(strcmp(argv[2], "succinct") == 0) {
+            m.setSuccinctTries(true);
+        } else if(strcmp(argv[2], "minimized") == 0) {
+            m.setMinimizedIndexes(true);
+        } else {
+            printf("Unknown mode %s.\n", argv[2]);
+            return 1;
+        }
+    }
+    load_data(m, argv[1]);
+    print_usage(m.memoryUsage());
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    try {
+        return run_test(argc, argv);
+    } catch(std::exception &e) {
+        printf("Fail: %s.\n", e.what());
+        return 105;
+    }
+}